@@ -0,0 +1,52 @@
+// Asset table and bundle format shared by the game and tools/pack_assets.cpp.
+// A bundle is a BundleHeader, then entryCount BundleEntry records, then the payloads
+// (each at a BUNDLE_ALIGN-aligned offset). Integers are little endian.
+#pragma once
+#include <SDL3/SDL.h>
+
+// Loose images drawn as their own textures
+enum ImageId { IMAGE_BACKGROUND, IMAGE_LOGO, IMAGE_BUTTON, IMAGE_COUNT };
+const char* const IMAGE_PATHS[IMAGE_COUNT] = { "Assets/background.png", "Assets/uet.png", "Assets/button.png" };
+
+// Sprite Atlas: world and HUD sprites share one texture so they can be drawn in one batch
+enum SpriteId { SPRITE_OBSTACLE, SPRITE_COLLECTIBLE, SPRITE_DAMAGE_ITEM, SPRITE_MYSTERY_ITEM, SPRITE_PLAYER, SPRITE_HEART_FULL, SPRITE_HEART_EMPTY, SPRITE_COUNT };
+const char* const SPRITE_PATHS[SPRITE_COUNT] = { "Assets/deadline.png", "Assets/item.png", "Assets/bad.png", "Assets/mystery.png", "Assets/player.png", "Assets/heart_full.png", "Assets/heart_empty.png" };
+const int ATLAS_CELL_SIZE = 256;
+const int ATLAS_COLUMNS = 4;
+const int ATLAS_ROWS = (SPRITE_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+// Cells keep a 1px transparent border so linear filtering never bleeds between sprites
+inline SDL_Rect spriteCell(int i) { return {(i % ATLAS_COLUMNS) * ATLAS_CELL_SIZE + 1, (i / ATLAS_COLUMNS) * ATLAS_CELL_SIZE + 1, ATLAS_CELL_SIZE - 2, ATLAS_CELL_SIZE - 2}; }
+
+const char* const FONT_PATH = "Fredoka_SemiCondensed-Medium.ttf";
+
+// Bundle Format
+const char* const BUNDLE_PATH = "assets.uetb";
+const char BUNDLE_MAGIC[4] = {'U', 'E', 'T', 'B'};
+const Uint32 BUNDLE_VERSION = 2; // 2 = per-source size and modification time
+const Uint32 BUNDLE_ALIGN = 64;
+// ARGB8888 is the preferred texture format of the Direct3D, OpenGL and Metal renderers, so uploads need no conversion
+const SDL_PixelFormat BUNDLE_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+const char* const BUNDLE_ATLAS_NAME = "atlas";
+
+enum BundleEntryType : Uint32 {
+    BUNDLE_IMAGE = 1,  // pixels: width x height rows of pitch bytes in format
+    BUNDLE_SPRITE = 2, // layout only: x, y, width, height inside the atlas image
+    BUNDLE_FONT = 3    // raw font file bytes
+};
+struct BundleHeader { char magic[4]; Uint32 version; Uint32 entryCount; Uint32 reserved; };
+struct BundleEntry {
+    char name[48]; // asset path, or BUNDLE_ATLAS_NAME
+    Uint32 type, format, x, y, width, height, pitch, reserved;
+    Uint64 offset, size;                 // payload location from the start of the file
+    Uint64 sourceSize; Sint64 sourceTime; // the asset file as packed; 0 for the atlas, which has no single source
+};
+static_assert(sizeof(BundleHeader) == 16, "bundle header layout");
+static_assert(sizeof(BundleEntry) == 112, "bundle entry layout");
+
+// Size and modification time (SDL_Time, ns) of an asset file; the game compares them to spot a stale bundle
+inline bool bundleSourceStamp(const char* path, Uint64& size, Sint64& time) {
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(path, &info) || info.type != SDL_PATHTYPE_FILE) return false;
+    size = info.size; time = info.modify_time;
+    return true;
+}
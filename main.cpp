@@ -2,6 +2,7 @@
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
 #include <SDL3_ttf/SDL_ttf.h>
+#include "asset_bundle.h"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -11,6 +12,32 @@
 #include <algorithm>
 #include <functional>
 #include <cstddef>
+#include <utility>
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UET_RUN_SSE2 1
+#endif
 
 enum class Scene {
     MENU,
@@ -21,8 +48,18 @@ enum class Scene {
     GAME_OVER
 };
 
+// Small self-contained PRNG (PCG32) with independent streams. All gameplay randomness draws
+// from streams seeded per session, so a seed and the inputs reproduce a run exactly
+struct Rng {
+    Uint64 state = 0, inc = 1;
+    Rng(Uint64 seed = 0, Uint64 stream = 0) : state(0), inc((stream << 1u) | 1u) { next(); state += seed; next(); }
+    Uint32 next() { Uint64 old = state; state = old * 6364136223846793005ULL + inc; Uint32 xs = (Uint32)(((old >> 18u) ^ old) >> 27u); Uint32 rot = (Uint32)(old >> 59u); return (xs >> rot) | (xs << ((32u - rot) & 31u)); }
+    int range(int n) { return (int)(next() % (Uint32)n); }
+};
+
 struct Player {
     SDL_FRect rect;
+    SDL_FRect prevRect; // rect at the start of the last simulation step, for render interpolation
     float velocityX;
     float velocityY;
     bool onGround;
@@ -33,7 +70,7 @@ struct Player {
     float jumpBufferTimer;
     bool jumpInputPressed;
 
-    Player() : rect{100, 400, 120, 140}, velocityX(0), velocityY(0),
+    Player() : rect{100, 400, 120, 140}, prevRect(rect), velocityX(0), velocityY(0),
              onGround(false), hp(100),
              color{255, 100, 100, 255},
              canDoubleJump(false),
@@ -42,30 +79,6 @@ struct Player {
              jumpInputPressed(false) {}
 };
 
-struct Obstacle {
-    SDL_FRect rect; SDL_Color color; bool isPassed;
-    Obstacle(float x, float y, float w, float h, SDL_Color c) : rect{x, y, w, h}, color(c), isPassed(false) {}
-};
-
-struct Collectible {
-    SDL_FRect rect; SDL_Color color; bool isCollected;
-    Collectible(float x, float y, float w, float h, SDL_Color c) : rect{x, y, w, h}, color(c), isCollected(false) {}
-};
-
-struct DamageItem {
-    SDL_FRect rect; SDL_Color color; bool isCollected;
-    float baseVelocityX; float velocityX; float startX; float moveRange;
-    DamageItem(float x, float y, float w, float h, SDL_Color c)
-        : rect{x, y, w, h}, color(c), isCollected(false),
-          baseVelocityX(100.0f + (rand() % 50)), velocityX(baseVelocityX), startX(x),
-          moveRange(80.0f + (rand() % 40)) { if (rand() % 2 == 0) { baseVelocityX = -baseVelocityX; velocityX = baseVelocityX; } }
-};
-
-struct MysteryItem {
-    SDL_FRect rect; SDL_Color color; bool isCollected;
-    MysteryItem(float x, float y, float w, float h, SDL_Color c) : rect{x, y, w, h}, color(c), isCollected(false) {}
-};
-
 // --- Global Variables ---
 SDL_Window* g_window = nullptr;
 SDL_Renderer* g_renderer = nullptr;
@@ -73,14 +86,8 @@ TTF_Font* g_font = nullptr;
 TTF_Font* g_smallFont = nullptr;
 SDL_Texture* g_logoTexture = nullptr;
 SDL_Texture* g_buttonTexture = nullptr;
-SDL_Texture* g_player = nullptr;
 SDL_Texture* g_backgroundTexture = nullptr;
-SDL_Texture* g_damageItemTexture = nullptr;
-SDL_Texture* g_collectibleTexture = nullptr;
-SDL_Texture* g_mysteryItemTexture = nullptr;
-SDL_Texture* g_obstacleTexture = nullptr;
-SDL_Texture* g_heartFullTexture = nullptr;
-SDL_Texture* g_heartEmptyTexture = nullptr;
+SDL_Texture** const IMAGE_TEXTURES[IMAGE_COUNT] = { &g_backgroundTexture, &g_logoTexture, &g_buttonTexture };
 float g_bgWidth = 0.0f;
 float g_bgHeight = 0.0f;
 float g_menuBgOffsetX = 0.0f;
@@ -89,9 +96,7 @@ Uint8 g_alpha = 0;
 bool g_shrinking = false;
 Uint32 g_startTime = 0;
 Scene g_currentScene = Scene::MENU;
-Player player;
-Uint64 g_lastTime = 0;
-float g_cameraX = 0.0f;
+Uint64 g_lastTime = 0; // SDL_GetTicksNS() of the last frame that advanced time
 bool g_gameInProgress = false;
 
 // Physics constants
@@ -99,7 +104,6 @@ const float GRAVITY = 2200.0f;
 const float JUMP_INITIAL_VELOCITY = -800.0f;
 const float MOVE_ACCELERATION = 2500.0f;
 const float MAX_MOVE_SPEED = 350.0f;
-float g_maxMoveSpeed = MAX_MOVE_SPEED;
 const float GROUND_DECELERATION = 2500.0f;
 const float AIR_DECELERATION = 1000.0f;
 const float JUMP_GRAVITY_MODIFIER = 0.55f;
@@ -107,42 +111,133 @@ const float JUMP_CUT_VELOCITY_REDUCTION = 0.45f;
 const float COYOTE_TIME_DURATION = 0.12f;
 const float JUMP_BUFFER_DURATION = 0.12f;
 
+// Simulation runs at a fixed rate on its own thread; rendering interpolates between the last two steps
+const float SIM_DT = 1.0f / 120.0f;
+const Uint64 SIM_DT_NS = 1000000000ull / 120u;
+const int MAX_SIM_STEPS_PER_FRAME = 8; // ticks run back to back before a backlog is dropped
+
 // Game world constants
 const float GROUND_Y = 460.0f;
 const float TRACK_LENGTH = 30000.0f;
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 
-// Game object lists
-std::vector<Obstacle> g_obstacles;
-std::vector<Collectible> g_collectibles;
-std::vector<DamageItem> g_damageItems;
-std::vector<MysteryItem> g_mysteryItems;
+// Track Streaming: the track is generated in fixed-width chunks just ahead of the camera and
+// chunks that fall behind it are recycled in a ring, so memory stays bounded in endless mode.
+// Each entity kind draws from its own RNG stream and only checks overlaps against neighbouring
+// chunks, so a given seed produces the same track however the camera moves.
+const float CHUNK_WIDTH = 1024.0f;
+const int CHUNK_RING_SIZE = 8;
+const float MAX_ENTITY_WIDTH = 130.0f; // widest obstacle
+const float MAX_PATROL_RANGE = 120.0f; // damage items patrol startX +- moveRange
+const float ENTITY_REACH = MAX_ENTITY_WIDTH + MAX_PATROL_RANGE; // how far an entity can extend left of its chunk key
+enum EntityKind : Uint8 { KIND_OBSTACLE, KIND_COLLECTIBLE, KIND_DAMAGE_ITEM, KIND_MYSTERY_ITEM, KIND_COUNT };
+enum EntityFlags : Uint8 { ENTITY_COLLECTED = 1, ENTITY_PASSED = 2 };
+enum ObstacleVariant : Uint8 { OBSTACLE_BOX, OBSTACLE_TALL, OBSTACLE_WIDE, OBSTACLE_FINISH, OBSTACLE_VARIANT_COUNT };
+const char* const OBSTACLE_VARIANT_NAMES[OBSTACLE_VARIANT_COUNT] = { "box", "tall", "wide", "finish post" };
+
+// Entity Store: a chunk's entities as structure-of-arrays, grouped by kind in generation order,
+// so the patrol and overlap kernels stream only the columns they read
+struct EntityStore {
+    std::vector<float> x, y, w, h;
+    std::vector<float> prevX;       // x before the last simulation step, for render interpolation
+    std::vector<float> velocityX;   // patrol velocity; 0 for static or collected entities
+    std::vector<float> startX;      // spawn x, also the chunk key
+    std::vector<float> moveRange;   // patrol half-range
+    std::vector<Uint8> flags;
+    std::vector<Uint8> variant;     // ObstacleVariant for obstacles
+    Uint32 kindStart[KIND_COUNT + 1] = {};
+
+    size_t size() const { return x.size(); }
+    Uint32 begin(EntityKind k) const { return kindStart[k]; }
+    Uint32 end(EntityKind k) const { return kindStart[k + 1]; }
+    SDL_FRect rect(size_t i) const { return {x[i], y[i], w[i], h[i]}; }
+    void clear() {
+        for (auto* col : {&x, &y, &w, &h, &prevX, &velocityX, &startX, &moveRange}) col->clear();
+        flags.clear(); variant.clear(); for (auto& k : kindStart) k = 0;
+    }
+    // Kinds must be appended in EntityKind order within a chunk
+    size_t add(EntityKind kind, float ex, float ey, float ew, float eh, float vx = 0.0f, float range = 0.0f, Uint8 v = 0) {
+        x.push_back(ex); y.push_back(ey); w.push_back(ew); h.push_back(eh); prevX.push_back(ex);
+        velocityX.push_back(vx); startX.push_back(ex); moveRange.push_back(range); flags.push_back(0); variant.push_back(v);
+        for (int k = kind + 1; k <= KIND_COUNT; k++) kindStart[k] = (Uint32)size();
+        return size() - 1;
+    }
+};
+
+struct TrackChunk {
+    int index = -1; // chunk number along the track, -1 while the slot is free
+    EntityStore entities;
+};
+struct KindStream { Rng rng; float nextX = 0.0f; int nextChunk = 0; };
+struct Track {
+    bool endless = false;
+    TrackChunk chunks[CHUNK_RING_SIZE];
+    KindStream streams[KIND_COUNT];
+    int firstChunk = 0; // oldest resident chunk
+    int passChunk = 0; size_t passIndex = 0; // next obstacle to score
+    Uint64 generatedEntities = 0;
+    Uint64 overlapTests = 0; // spawn candidates tested during generation
+};
+bool g_endlessMode = false;
+
+// Session randomness: g_seedRng hands out one seed per session; each World seeds its gameplay rolls from it
+const Uint64 SESSION_RNG_STREAM = 64;
+Rng g_seedRng;
 
 // Game state variables
-int g_score = 0; int g_level = 1; int g_itemCount = 0; int g_totalItemCount = 0;
 const int ITEMS_PER_LEVEL = 10; Uint32 g_gameStartTime = 0; Uint32 g_playTimeSeconds = 0;
-float g_damageItemSpeedMultiplier = 1.0f;
 
 const std::vector<std::string> LEVEL_NAMES = { "Unknown", "Freshman", "Sophomore", "Junior", "Senior", "Master", "Ph.D", "Associate Professor", "Professor" };
 const int MAX_LEVEL = LEVEL_NAMES.size() - 1;
 
+// Difficulty ramp applied on every level up
+struct Difficulty { int itemsPerLevel = ITEMS_PER_LEVEL; float speedRamp = 1.05f; float damageSpeedRamp = 1.1f; };
+
+enum WorldOutcome { WORLD_RUNNING, WORLD_FINISHED, WORLD_DIED };
+enum DeathCause { DEATH_NONE, DEATH_DAMAGE_ITEM, DEATH_MYSTERY_ITEM, DEATH_FALL, DEATH_CAUSE_COUNT };
+const char* const DEATH_CAUSE_NAMES[DEATH_CAUSE_COUNT] = { "none", "damage item", "mystery item", "fall" };
+enum WorldEvents : Uint32 { WORLD_EVENT_LEVEL_UP = 1, WORLD_EVENT_PICKUP = 2, WORLD_EVENT_DAMAGE = 4, WORLD_EVENT_HEAL = 8, WORLD_EVENT_LAND = 16 };
+struct WorldEvent { WorldEvents type; float x, y; int value; }; // value: points, hp change, new level or landing speed
+
+struct SweepHit { float t; EntityStore* store; Uint32 index; }; // time of impact in [0, 1] along a move
+
+// World: one session's simulation state. The game drives g_world; the batch simulator runs many side by side
+struct World {
+    Player player;
+    Track track;
+    Rng rng; // gameplay rolls
+    Difficulty difficulty;
+    float cameraX = 0.0f, prevCameraX = 0.0f;
+    int score = 0, level = 1, itemCount = 0, totalItemCount = 0;
+    float maxMoveSpeed = MAX_MOVE_SPEED, damageItemSpeedMultiplier = 1.0f;
+    Uint32 ticks = 0;
+    WorldOutcome outcome = WORLD_RUNNING; DeathCause deathCause = DEATH_NONE;
+    int blockedVariant = -1; Uint32 blockedTick = 0; // obstacle that last stopped the player
+    Uint32 events = 0; // WorldEvents raised by the last step
+    std::vector<WorldEvent> eventLog; // the same events with where they happened, for effects
+    std::vector<Uint32> overlapHits; // overlapKernel scratch
+    std::vector<SweepHit> sweepHits; // pickups reached this step, by time of impact
+};
+World g_world;
+
 std::vector<int> g_highScores;
 
+// Sprite Atlas (layout in asset_bundle.h)
+SDL_Texture* g_atlasTexture = nullptr;
+SDL_FRect g_spriteRects[SPRITE_COUNT] = {}; // w == 0 when the sprite failed to load
+std::vector<SDL_Vertex> g_spriteVertices;
+std::vector<int> g_spriteIndices;
+
 // UI Elements
 struct Button { std::string text; SDL_FRect rect; };
-std::vector<Button> g_buttons = { {"Play",{300,200,180,80}},{"Resume",{300,300,180,80}},{"Score",{300,400,180,80}} };
+std::vector<Button> g_buttons = { {"Play",{300,200,180,80}},{"Resume",{300,300,180,80}},{"Score",{300,400,180,80}},{"Endless",{300,500,180,80}} };
 std::vector<Button> g_pauseButtons = {
     {"Tiep tuc", {310, 250, 180, 80}},
     {"Menu chinh", {310, 350, 180, 80}}
 };
 
 // Effects Variables
-SDL_Texture* g_levelUpTextTexture = nullptr;
-SDL_FRect g_levelUpTextRect;
-Uint32 g_levelUpTextStartTime = 0;
-const float LEVEL_UP_TEXT_VELOCITY_Y = -50.0f;
-const Uint32 LEVEL_UP_TEXT_DURATION = 2000;
 bool g_playerIsFlashing = false;
 Uint32 g_flashStartTime = 0;
 const Uint32 FLASH_DURATION = 2000;
@@ -165,6 +260,142 @@ bool checkRectCollision(const SDL_FRect& a, const SDL_FRect& b) {
 bool checkCollision(float x, float y, const SDL_FRect& rect) {
     return (x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h);
 }
+// Broadphase: a query only visits the resident chunks whose entities can reach [minX, maxX)
+struct ChunkSpan {
+    TrackChunk* chunks[CHUNK_RING_SIZE]; int count = 0;
+    TrackChunk** begin() { return chunks; } TrackChunk** end() { return chunks + count; }
+};
+inline int chunkOf(float x) { return (int)std::floor(x / CHUNK_WIDTH); }
+TrackChunk* trackChunk(Track& t, int index) {
+    if (index < 0) return nullptr;
+    TrackChunk& c = t.chunks[index % CHUNK_RING_SIZE];
+    return c.index == index ? &c : nullptr;
+}
+ChunkSpan chunksNear(Track& t, float minX, float maxX) {
+    ChunkSpan span;
+    const int first = std::max(chunkOf(minX - ENTITY_REACH), t.firstChunk), last = chunkOf(maxX + MAX_PATROL_RANGE);
+    for (int i = first; i <= last && span.count < CHUNK_RING_SIZE; i++) if (TrackChunk* c = trackChunk(t, i)) span.chunks[span.count++] = c;
+    return span;
+}
+
+// Frame Profiler: frame times and counters are always kept in a rolling window; the scoped phase timers
+// only read the clock while the F3 overlay is up or --profile FILE is logging for Chrome-trace JSON / CSV export
+enum ProfPhase { PROF_EVENTS, PROF_SIM_DAMAGE, PROF_SIM_PLAYER, PROF_SIM_STREAM, PROF_DRAW_WORLD, PROF_DRAW_HUD, PROF_DRAW_SCENE, PROF_PRESENT, PROF_CAPTURE, PROF_COUNT };
+const char* const PROF_PHASE_NAMES[PROF_COUNT] = {"events", "sim.damage", "sim.player", "sim.stream", "draw.world", "draw.hud", "draw.scene", "present", "capture"};
+struct FrameProfile { Uint64 start = 0, ticks = 0; Uint64 phaseTicks[PROF_COUNT] = {}; Uint32 simSteps = 0, drawCalls = 0, texturesCreated = 0, entitiesTested = 0, particles = 0; };
+struct TraceEvent { Uint64 start, ticks; Uint8 phase, thread; };
+const int PROF_HISTORY = 240;
+const size_t PROF_LOG_FRAMES = 8192, PROF_LOG_EVENTS = PROF_LOG_FRAMES * 16; // export keeps the newest frames and trace events in rings
+thread_local FrameProfile g_prof; FrameProfile g_profHistory[PROF_HISTORY]; Uint32 g_profFrames = 0;
+std::atomic<bool> g_profOverlay{false}; bool g_profLogging = false; std::string g_profPath;
+std::vector<FrameProfile> g_profLog; std::vector<TraceEvent> g_profTrace; Uint64 g_profLogged = 0, g_profTraced = 0; std::mutex g_profTraceMutex;
+thread_local Uint8 g_profThread = 1; // trace lane: 1 main, 2 simulation
+// Sim-thread counters handed to the frame being rendered
+std::atomic<Uint64> g_simPhaseTicks[PROF_COUNT]; std::atomic<Uint32> g_simSteps{0}, g_simEntitiesTested{0};
+
+inline bool profPhasesOn() { return g_profOverlay || g_profLogging; }
+inline Uint64 profStart() { return profPhasesOn() ? SDL_GetPerformanceCounter() : 0; }
+void profRecord(ProfPhase phase, Uint64 start) {
+    if (start == 0) return;
+    Uint64 t = SDL_GetPerformanceCounter() - start; g_prof.phaseTicks[phase] += t;
+    if (g_profLogging) {
+        std::lock_guard<std::mutex> lock(g_profTraceMutex);
+        const TraceEvent ev = {start, t, (Uint8)phase, g_profThread};
+        if (g_profTrace.size() < PROF_LOG_EVENTS) g_profTrace.push_back(ev); else g_profTrace[g_profTraced % PROF_LOG_EVENTS] = ev;
+        g_profTraced++;
+    }
+}
+struct ProfScope {
+    ProfPhase phase; Uint64 start;
+    explicit ProfScope(ProfPhase p) : phase(p), start(profStart()) {}
+    ~ProfScope() { profRecord(phase, start); }
+};
+// The sim thread hands its counters over after each batch of ticks; the render thread folds them into its frame
+void profFlushSimThread() {
+    for (int p = 0; p < PROF_COUNT; p++) if (g_prof.phaseTicks[p]) g_simPhaseTicks[p] += g_prof.phaseTicks[p];
+    g_simSteps += g_prof.simSteps; g_simEntitiesTested += g_prof.entitiesTested;
+    g_prof = FrameProfile();
+}
+void profCollectSimThread() {
+    for (int p = 0; p < PROF_COUNT; p++) g_prof.phaseTicks[p] += g_simPhaseTicks[p].exchange(0);
+    g_prof.simSteps += g_simSteps.exchange(0); g_prof.entitiesTested += g_simEntitiesTested.exchange(0);
+}
+void profBeginFrame() { g_prof = FrameProfile(); g_prof.start = SDL_GetPerformanceCounter(); }
+void profEndFrame() {
+    g_prof.ticks = SDL_GetPerformanceCounter() - g_prof.start;
+    g_profHistory[g_profFrames % PROF_HISTORY] = g_prof; g_profFrames++;
+    if (!g_profLogging) return;
+    if (g_profLog.size() < PROF_LOG_FRAMES) g_profLog.push_back(g_prof); else g_profLog[g_profLogged % PROF_LOG_FRAMES] = g_prof;
+    g_profLogged++;
+}
+
+// Entity Kernels: patrol update and AABB overlap over a store range. The AVX / SSE2 paths
+// process 8 / 4 entities per iteration and hand the tail to the scalar versions.
+void patrolScalar(EntityStore& e, size_t begin, size_t end, float speedScale) {
+    for (size_t i = begin; i < end; i++) {
+        e.prevX[i] = e.x[i];
+        float v = e.velocityX[i], nx = e.x[i] + v * speedScale, hi = e.startX[i] + e.moveRange[i], lo = e.startX[i] - e.moveRange[i];
+        if (v > 0 && nx >= hi) { nx = hi; v = -v; }
+        else if (v < 0 && nx <= lo) { nx = lo; v = -v; }
+        e.x[i] = nx; e.velocityX[i] = v;
+    }
+}
+void overlapScalar(const EntityStore& e, size_t begin, size_t end, const SDL_FRect& r, std::vector<Uint32>& hits) {
+    for (size_t i = begin; i < end; i++)
+        if (r.x < e.x[i] + e.w[i] && r.x + r.w > e.x[i] && r.y < e.y[i] + e.h[i] && r.y + r.h > e.y[i]) hits.push_back((Uint32)i);
+}
+void patrolKernel(EntityStore& e, size_t begin, size_t end, float speedScale) {
+    size_t i = begin;
+#if defined(__AVX__)
+    const __m256 scale = _mm256_set1_ps(speedScale), zero = _mm256_setzero_ps(), sign = _mm256_set1_ps(-0.0f);
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(&e.x[i]), v = _mm256_loadu_ps(&e.velocityX[i]), start = _mm256_loadu_ps(&e.startX[i]), range = _mm256_loadu_ps(&e.moveRange[i]);
+        _mm256_storeu_ps(&e.prevX[i], x);
+        __m256 nx = _mm256_add_ps(x, _mm256_mul_ps(v, scale)), hi = _mm256_add_ps(start, range), lo = _mm256_sub_ps(start, range);
+        __m256 overR = _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GT_OQ), _mm256_cmp_ps(nx, hi, _CMP_GE_OQ));
+        __m256 overL = _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ), _mm256_cmp_ps(nx, lo, _CMP_LE_OQ));
+        nx = _mm256_blendv_ps(_mm256_blendv_ps(nx, lo, overL), hi, overR);
+        v = _mm256_xor_ps(v, _mm256_and_ps(_mm256_or_ps(overR, overL), sign));
+        _mm256_storeu_ps(&e.x[i], nx); _mm256_storeu_ps(&e.velocityX[i], v);
+    }
+#elif defined(UET_RUN_SSE2)
+    const __m128 scale = _mm_set1_ps(speedScale), zero = _mm_setzero_ps(), sign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(&e.x[i]), v = _mm_loadu_ps(&e.velocityX[i]), start = _mm_loadu_ps(&e.startX[i]), range = _mm_loadu_ps(&e.moveRange[i]);
+        _mm_storeu_ps(&e.prevX[i], x);
+        __m128 nx = _mm_add_ps(x, _mm_mul_ps(v, scale)), hi = _mm_add_ps(start, range), lo = _mm_sub_ps(start, range);
+        __m128 overR = _mm_and_ps(_mm_cmpgt_ps(v, zero), _mm_cmpge_ps(nx, hi));
+        __m128 overL = _mm_and_ps(_mm_cmplt_ps(v, zero), _mm_cmple_ps(nx, lo));
+        nx = _mm_or_ps(_mm_andnot_ps(_mm_or_ps(overR, overL), nx), _mm_or_ps(_mm_and_ps(overR, hi), _mm_and_ps(overL, lo)));
+        v = _mm_xor_ps(v, _mm_and_ps(_mm_or_ps(overR, overL), sign));
+        _mm_storeu_ps(&e.x[i], nx); _mm_storeu_ps(&e.velocityX[i], v);
+    }
+#endif
+    patrolScalar(e, i, end, speedScale);
+}
+// Appends the indices in [begin, end) whose rect overlaps r
+void overlapKernel(const EntityStore& e, size_t begin, size_t end, const SDL_FRect& r, std::vector<Uint32>& hits) {
+    size_t i = begin; g_prof.entitiesTested += (Uint32)(end - begin);
+#if defined(__AVX__)
+    const __m256 rx0 = _mm256_set1_ps(r.x), rx1 = _mm256_set1_ps(r.x + r.w), ry0 = _mm256_set1_ps(r.y), ry1 = _mm256_set1_ps(r.y + r.h);
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(&e.x[i]), y = _mm256_loadu_ps(&e.y[i]);
+        __m256 m = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(rx0, _mm256_add_ps(x, _mm256_loadu_ps(&e.w[i])), _CMP_LT_OQ), _mm256_cmp_ps(rx1, x, _CMP_GT_OQ)),
+                                 _mm256_and_ps(_mm256_cmp_ps(ry0, _mm256_add_ps(y, _mm256_loadu_ps(&e.h[i])), _CMP_LT_OQ), _mm256_cmp_ps(ry1, y, _CMP_GT_OQ)));
+        for (int bits = _mm256_movemask_ps(m); bits; bits &= bits - 1) { int lane = 0; while (!((bits >> lane) & 1)) lane++; hits.push_back((Uint32)(i + lane)); }
+    }
+#elif defined(UET_RUN_SSE2)
+    const __m128 rx0 = _mm_set1_ps(r.x), rx1 = _mm_set1_ps(r.x + r.w), ry0 = _mm_set1_ps(r.y), ry1 = _mm_set1_ps(r.y + r.h);
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(&e.x[i]), y = _mm_loadu_ps(&e.y[i]);
+        __m128 m = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(rx0, _mm_add_ps(x, _mm_loadu_ps(&e.w[i]))), _mm_cmpgt_ps(rx1, x)),
+                              _mm_and_ps(_mm_cmplt_ps(ry0, _mm_add_ps(y, _mm_loadu_ps(&e.h[i]))), _mm_cmpgt_ps(ry1, y)));
+        for (int bits = _mm_movemask_ps(m); bits; bits &= bits - 1) { int lane = 0; while (!((bits >> lane) & 1)) lane++; hits.push_back((Uint32)(i + lane)); }
+    }
+#endif
+    overlapScalar(e, i, end, r, hits);
+}
+
 void addHighScore(int score) {
     g_highScores.push_back(score);
     std::sort(g_highScores.begin(), g_highScores.end(), std::greater<int>());
@@ -172,54 +403,531 @@ void addHighScore(int score) {
 }
 
 // Object Creation Functions
-void createObstacles() {
-    g_obstacles.clear();
-    for (float x=800;x<TRACK_LENGTH;x+=350+(rand()%250)){ int t=rand()%3; switch(t){ case 0:g_obstacles.push_back(Obstacle(x,GROUND_Y-80,80,80,{139,69,19,255}));break; case 1:g_obstacles.push_back(Obstacle(x,GROUND_Y-130,70,130,{128,128,128,255}));break; case 2:g_obstacles.push_back(Obstacle(x,GROUND_Y-50,130,50,{160,82,45,255}));break; } }
-    g_obstacles.push_back(Obstacle(TRACK_LENGTH+100,GROUND_Y-250,30,250,{255,215,0,255}));
+void recycleChunk(TrackChunk& c) { c.index = -1; c.entities.clear(); }
+TrackChunk& prepareChunk(Track& t, int index) {
+    TrackChunk& c = t.chunks[index % CHUNK_RING_SIZE];
+    if (c.index != index) { recycleChunk(c); c.index = index; }
+    return c;
+}
+// Padded overlap test against one kind in chunks index-1..index+1, using spawn positions
+bool overlapsNeighbours(Track& t, int index, EntityKind kind, const SDL_FRect& r, float pad) {
+    for (int i = index - 1; i <= index + 1; i++) {
+        TrackChunk* c = trackChunk(t, i); if (!c) continue;
+        const EntityStore& e = c->entities; t.overlapTests += e.end(kind) - e.begin(kind);
+        for (Uint32 j = e.begin(kind); j < e.end(kind); j++) { SDL_FRect b = {e.startX[j]-pad, e.y[j]-pad, e.w[j]+2*pad, e.h[j]+2*pad}; if (checkRectCollision(r, b)) return true; }
+    }
+    return false;
+}
+
+void createObstacles(Track& t, int index) {
+    KindStream& k = t.streams[KIND_OBSTACLE]; EntityStore& e = prepareChunk(t, index).entities; const float end = (index + 1) * CHUNK_WIDTH;
+    for (;k.nextX<end&&(t.endless||k.nextX<TRACK_LENGTH);k.nextX+=350+k.rng.range(250)){ float x=k.nextX; int type=k.rng.range(3); switch(type){ case OBSTACLE_BOX:e.add(KIND_OBSTACLE,x,GROUND_Y-80,80,80,0,0,OBSTACLE_BOX);break; case OBSTACLE_TALL:e.add(KIND_OBSTACLE,x,GROUND_Y-130,70,130,0,0,OBSTACLE_TALL);break; case OBSTACLE_WIDE:e.add(KIND_OBSTACLE,x,GROUND_Y-50,130,50,0,0,OBSTACLE_WIDE);break; } t.generatedEntities++; }
+    if (!t.endless && chunkOf(TRACK_LENGTH+100) == index) { e.add(KIND_OBSTACLE,TRACK_LENGTH+100,GROUND_Y-250,30,250,0,0,OBSTACLE_FINISH); t.generatedEntities++; }
 }
-void createCollectibles() {
-    g_collectibles.clear(); const float iw=40,ih=40,ob=15;
-    for(float x=700;x<TRACK_LENGTH-200;x+=250+(rand()%200)){ float y;int yc=rand()%3; if(yc==0)y=GROUND_Y-ih-5; else if(yc==1)y=GROUND_Y-150; else y=GROUND_Y-220; SDL_FRect nr={x,y,iw,ih}; bool ol=false; for(const auto&o:g_obstacles){ SDL_FRect b=o.rect; b.x-=ob;b.y-=ob;b.w+=2*ob;b.h+=2*ob; if(checkRectCollision(nr,b)){ol=true;break;} } if(!ol)g_collectibles.push_back(Collectible(x,y,iw,ih,{255,255,0,255})); }
+void createCollectibles(Track& t, int index) {
+    KindStream& k = t.streams[KIND_COLLECTIBLE]; EntityStore& e = prepareChunk(t, index).entities; const float end = (index + 1) * CHUNK_WIDTH; const float iw=40,ih=40,ob=15;
+    for(;k.nextX<end&&(t.endless||k.nextX<TRACK_LENGTH-200);k.nextX+=250+k.rng.range(200)){ float x=k.nextX; float y;int yc=k.rng.range(3); if(yc==0)y=GROUND_Y-ih-5; else if(yc==1)y=GROUND_Y-150; else y=GROUND_Y-220; SDL_FRect nr={x,y,iw,ih}; if(overlapsNeighbours(t,index,KIND_OBSTACLE,nr,ob))continue; e.add(KIND_COLLECTIBLE,x,y,iw,ih); t.generatedEntities++; }
 }
-void createDamageItems() {
-    g_damageItems.clear(); const float iw=40,ih=40,ob=15,cb=10;
-    for(float x=1200;x<TRACK_LENGTH-300;x+=500+(rand()%300)){ float y;int yc=rand()%2; if(yc==0)y=GROUND_Y-ih-5; else y=GROUND_Y-100; SDL_FRect nr={x,y,iw,ih}; bool ol=false; for(const auto&o:g_obstacles){ SDL_FRect b=o.rect; b.x-=ob;b.y-=ob;b.w+=2*ob;b.h+=2*ob; if(checkRectCollision(nr,b)){ol=true;break;} } if(ol)continue; for(const auto&c:g_collectibles){ SDL_FRect b=c.rect; b.x-=cb;b.y-=cb;b.w+=2*cb;b.h+=2*cb; if(!c.isCollected&&checkRectCollision(nr,b)){ol=true;break;} } if(ol)continue; g_damageItems.push_back(DamageItem(x,y,iw,ih,{255,0,0,255})); }
+void createDamageItems(Track& t, int index) {
+    KindStream& k = t.streams[KIND_DAMAGE_ITEM]; EntityStore& e = prepareChunk(t, index).entities; const float end = (index + 1) * CHUNK_WIDTH; const float iw=40,ih=40,ob=15,cb=10;
+    for(;k.nextX<end&&(t.endless||k.nextX<TRACK_LENGTH-300);k.nextX+=500+k.rng.range(300)){ float x=k.nextX; float y;int yc=k.rng.range(2); if(yc==0)y=GROUND_Y-ih-5; else y=GROUND_Y-100; SDL_FRect nr={x,y,iw,ih}; if(overlapsNeighbours(t,index,KIND_OBSTACLE,nr,ob))continue; if(overlapsNeighbours(t,index,KIND_COLLECTIBLE,nr,cb))continue; float v=100.0f+k.rng.range(50); float range=80.0f+k.rng.range(40); if(k.rng.range(2)==0)v=-v; e.add(KIND_DAMAGE_ITEM,x,y,iw,ih,v,range); t.generatedEntities++; }
 }
-void createMysteryItems() {
-    g_mysteryItems.clear(); const float iw=40,ih=40,ob=20,ib=15;
-    for(float x=900;x<TRACK_LENGTH-500;x+=1200+(rand()%800)){ float y=GROUND_Y-160-(rand()%50); SDL_FRect nr={x,y,iw,ih}; bool ol=false; for(const auto&o:g_obstacles){ SDL_FRect b=o.rect; b.x-=ob;b.y-=ob;b.w+=2*ob;b.h+=2*ob; if(checkRectCollision(nr,b)){ol=true;break;} } if(ol)continue; for(const auto&c:g_collectibles){ SDL_FRect b=c.rect; b.x-=ib;b.y-=ib;b.w+=2*ib;b.h+=2*ib; if(!c.isCollected&&checkRectCollision(nr,b)){ol=true;break;} } if(ol)continue; for(const auto&d:g_damageItems){ SDL_FRect b=d.rect; b.x-=ib;b.y-=ib;b.w+=2*ib;b.h+=2*ib; if(!d.isCollected&&checkRectCollision(nr,b)){ol=true;break;} } if(ol)continue; g_mysteryItems.push_back(MysteryItem(x,y,iw,ih,{128,0,128,255})); }
+void createMysteryItems(Track& t, int index) {
+    KindStream& k = t.streams[KIND_MYSTERY_ITEM]; EntityStore& e = prepareChunk(t, index).entities; const float end = (index + 1) * CHUNK_WIDTH; const float iw=40,ih=40,ob=20,ib=15;
+    for(;k.nextX<end&&(t.endless||k.nextX<TRACK_LENGTH-500);k.nextX+=1200+k.rng.range(800)){ float x=k.nextX; float y=GROUND_Y-160-k.rng.range(50); SDL_FRect nr={x,y,iw,ih}; if(overlapsNeighbours(t,index,KIND_OBSTACLE,nr,ob))continue; if(overlapsNeighbours(t,index,KIND_COLLECTIBLE,nr,ib))continue; if(overlapsNeighbours(t,index,KIND_DAMAGE_ITEM,nr,ib))continue; e.add(KIND_MYSTERY_ITEM,x,y,iw,ih); t.generatedEntities++; }
+}
+
+void trackReset(Track& t, Uint64 seed, bool endless) {
+    const float startX[KIND_COUNT] = {800.0f, 700.0f, 1200.0f, 900.0f};
+    for (auto& c : t.chunks) recycleChunk(c);
+    for (int k = 0; k < KIND_COUNT; k++) { t.streams[k].rng = Rng(seed, (Uint64)k); t.streams[k].nextX = startX[k]; t.streams[k].nextChunk = 0; }
+    t.endless = endless; t.firstChunk = 0; t.passChunk = 0; t.passIndex = 0; t.generatedEntities = 0; t.overlapTests = 0;
+}
+// Recycles chunks the camera has left behind and generates ahead of it. Earlier kinds run
+// one chunk further ahead than the kinds that check against them.
+void trackStream(Track& t, float cameraX) {
+    while (t.firstChunk < t.streams[KIND_MYSTERY_ITEM].nextChunk && (t.firstChunk + 1) * CHUNK_WIDTH + ENTITY_REACH < cameraX) {
+        if (TrackChunk* c = trackChunk(t, t.firstChunk)) recycleChunk(*c);
+        t.firstChunk++;
+    }
+    const int needed = chunkOf(cameraX + SCREEN_WIDTH + CHUNK_WIDTH / 2);
+    void (*const generators[KIND_COUNT])(Track&, int) = {createObstacles, createCollectibles, createDamageItems, createMysteryItems};
+    for (int k = 0; k < KIND_COUNT; k++) {
+        KindStream& stream = t.streams[k];
+        for (const int target = needed + (KIND_COUNT - 1 - k); stream.nextChunk <= target; stream.nextChunk++) generators[k](t, stream.nextChunk);
+    }
+}
+
+// Session Seeds: one per run, drawn in order. The next seed can be peeked so its track is built ahead of time
+Uint64 g_nextSeed = 0; bool g_hasNextSeed = false;
+Uint64 peekSessionSeed() {
+    if (!g_hasNextSeed) { g_nextSeed = ((Uint64)g_seedRng.next() << 32) | g_seedRng.next(); g_hasNextSeed = true; }
+    return g_nextSeed;
+}
+Uint64 takeSessionSeed() { Uint64 seed = peekSessionSeed(); g_hasNextSeed = false; return seed; }
+void seedSessions(Uint64 seed) { g_seedRng = Rng(seed); g_hasNextSeed = false; }
+
+// Track Pre-generation: while no run is playing, a worker thread builds the next run's opening track in
+// both modes. Starting a run swaps the ready one into g_world.track; it generates in place only when none is ready
+struct PreparedTracks {
+    std::thread worker;
+    std::atomic<bool> ready{false};
+    bool valid = false; // tracks are built, or being built, for seed
+    Uint64 seed = 0;
+    Track tracks[2];    // [endless]
+};
+PreparedTracks g_preparedTracks;
+
+void prepareNextTrack() {
+    PreparedTracks& p = g_preparedTracks;
+    const Uint64 seed = peekSessionSeed();
+    if (p.valid && p.seed == seed) return;
+    if (p.worker.joinable()) p.worker.join();
+    p.seed = seed; p.valid = true; p.ready.store(false, std::memory_order_relaxed);
+    p.worker = std::thread([&p, seed]() {
+        for (int endless = 0; endless < 2; endless++) { trackReset(p.tracks[endless], seed, endless != 0); trackStream(p.tracks[endless], 0.0f); }
+        p.ready.store(true, std::memory_order_release);
+    });
+}
+bool takePreparedTrack(Uint64 seed, bool endless) {
+    PreparedTracks& p = g_preparedTracks;
+    if (!p.valid || p.seed != seed || !p.ready.load(std::memory_order_acquire)) return false;
+    p.worker.join(); p.valid = false;
+    std::swap(g_world.track, p.tracks[endless ? 1 : 0]);
+    return true;
+}
+void stopTrackPreparation() { if (g_preparedTracks.worker.joinable()) g_preparedTracks.worker.join(); g_preparedTracks.valid = false; }
+
+// Atlas Functions
+SDL_Surface* createAtlasSurface() {
+    SDL_Surface* atlas = SDL_CreateSurface(ATLAS_COLUMNS * ATLAS_CELL_SIZE, ATLAS_ROWS * ATLAS_CELL_SIZE, SDL_PIXELFORMAT_RGBA32);
+    if (!atlas) { std::cout << "Failed create sprite atlas: " << SDL_GetError() << "\n"; return nullptr; }
+    SDL_FillSurfaceRect(atlas, nullptr, 0);
+    for (auto& r : g_spriteRects) r = {0, 0, 0, 0};
+    return atlas;
+}
+// Decodes one sprite and scales it to its cell size; touches no shared state, so it runs on loader threads
+SDL_Surface* decodeSpriteCell(int i) {
+    SDL_Surface* img = IMG_Load(SPRITE_PATHS[i]); if (!img) return nullptr;
+    SDL_Rect cell = spriteCell(i);
+    SDL_Surface* scaled = SDL_CreateSurface(cell.w, cell.h, SDL_PIXELFORMAT_RGBA32);
+    SDL_SetSurfaceBlendMode(img, SDL_BLENDMODE_NONE);
+    if (scaled && !SDL_BlitSurfaceScaled(img, nullptr, scaled, nullptr, SDL_SCALEMODE_LINEAR)) { SDL_DestroySurface(scaled); scaled = nullptr; }
+    SDL_DestroySurface(img);
+    return scaled;
+}
+void packSpriteCell(SDL_Surface* atlas, int i, SDL_Surface* cellSurface) {
+    SDL_Rect cell = spriteCell(i);
+    SDL_SetSurfaceBlendMode(cellSurface, SDL_BLENDMODE_NONE);
+    if (SDL_BlitSurface(cellSurface, nullptr, atlas, &cell)) g_spriteRects[i] = {(float)cell.x, (float)cell.y, (float)cell.w, (float)cell.h};
+    else std::cout << "Warning: Failed pack " << SPRITE_PATHS[i] << ": " << SDL_GetError() << "\n";
+}
+bool uploadSpriteAtlas(SDL_Surface* atlas) {
+    g_atlasTexture = SDL_CreateTextureFromSurface(g_renderer, atlas); g_prof.texturesCreated++;
+    if (!g_atlasTexture) { std::cout << "Failed create sprite atlas texture: " << SDL_GetError() << "\n"; return false; }
+    return true;
+}
+bool loadSpriteAtlas() {
+    SDL_Surface* atlas = createAtlasSurface(); if (!atlas) return false;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        SDL_Surface* cell = decodeSpriteCell(i);
+        if (!cell) { std::cout << "Warning: Failed load " << SPRITE_PATHS[i] << ": " << SDL_GetError() << "\n"; continue; }
+        packSpriteCell(atlas, i, cell); SDL_DestroySurface(cell);
+    }
+    bool ok = uploadSpriteAtlas(atlas);
+    SDL_DestroySurface(atlas);
+    return ok;
+}
+void pushSprite(SpriteId id, const SDL_FRect& dst, Uint8 alpha = 255) {
+    const SDL_FRect& src = g_spriteRects[id];
+    if (!g_atlasTexture || src.w <= 0) return;
+    float aw, ah; SDL_GetTextureSize(g_atlasTexture, &aw, &ah);
+    float u0 = (src.x + 0.5f) / aw, v0 = (src.y + 0.5f) / ah, u1 = (src.x + src.w - 0.5f) / aw, v1 = (src.y + src.h - 0.5f) / ah;
+    SDL_FColor c = {1.0f, 1.0f, 1.0f, alpha / 255.0f};
+    int base = (int)g_spriteVertices.size();
+    g_spriteVertices.push_back({{dst.x, dst.y}, c, {u0, v0}});
+    g_spriteVertices.push_back({{dst.x + dst.w, dst.y}, c, {u1, v0}});
+    g_spriteVertices.push_back({{dst.x + dst.w, dst.y + dst.h}, c, {u1, v1}});
+    g_spriteVertices.push_back({{dst.x, dst.y + dst.h}, c, {u0, v1}});
+    const int quad[6] = {0, 1, 2, 0, 2, 3};
+    for (int q : quad) g_spriteIndices.push_back(base + q);
+}
+void flushSprites() {
+    if (g_atlasTexture && !g_spriteIndices.empty()) { SDL_RenderGeometry(g_renderer, g_atlasTexture, g_spriteVertices.data(), (int)g_spriteVertices.size(), g_spriteIndices.data(), (int)g_spriteIndices.size()); g_prof.drawCalls++; }
+    g_spriteVertices.clear(); g_spriteIndices.clear();
+}
+void renderSprite(SpriteId id, const SDL_FRect& dst) {
+    if (g_atlasTexture && g_spriteRects[id].w > 0) { SDL_RenderTexture(g_renderer, g_atlasTexture, &g_spriteRects[id], &dst); g_prof.drawCalls++; }
+}
+
+// Text Cache: strings are rasterized once per (font, text, color) and reused until evicted.
+// Numbers that tick during play are stamped from a per-font digit atlas instead.
+struct TextKey {
+    TTF_Font* font; Uint32 color; std::string text;
+    bool operator==(const TextKey& o) const { return font == o.font && color == o.color && text == o.text; }
+};
+struct TextKeyHash {
+    size_t operator()(const TextKey& k) const { return std::hash<std::string>()(k.text) ^ (std::hash<const void*>()(k.font) * 31u) ^ (size_t)k.color * 0x9E3779B1u; }
+};
+struct CachedText { SDL_Texture* texture; float w, h; Uint64 lastUsedFrame; };
+struct DigitAtlas { TTF_Font* font; Uint32 color; SDL_Texture* texture; SDL_FRect glyphs[10]; };
+std::unordered_map<TextKey, CachedText, TextKeyHash> g_textCache;
+std::vector<DigitAtlas> g_digitAtlases;
+Uint64 g_frameCounter = 0;
+Uint64 g_textCacheHits = 0, g_textCacheMisses = 0, g_digitAtlasDraws = 0;
+const Uint64 TEXT_CACHE_EVICT_FRAMES = 600;
+
+inline Uint32 packColor(SDL_Color c) { return ((Uint32)c.r << 24) | ((Uint32)c.g << 16) | ((Uint32)c.b << 8) | c.a; }
+const CachedText* getCachedText(TTF_Font* font, const std::string& text, SDL_Color color) {
+    if (!font || text.empty()) return nullptr;
+    TextKey key{font, packColor(color), text};
+    auto it = g_textCache.find(key);
+    if (it != g_textCache.end()) { g_textCacheHits++; it->second.lastUsedFrame = g_frameCounter; return &it->second; }
+    g_textCacheMisses++; g_prof.texturesCreated++;
+    SDL_Surface* s = TTF_RenderText_Blended(font, text.c_str(), text.length(), color); if (!s) return nullptr;
+    SDL_Texture* t = SDL_CreateTextureFromSurface(g_renderer, s);
+    CachedText entry = {t, (float)s->w, (float)s->h, g_frameCounter};
+    SDL_DestroySurface(s); if (!t) return nullptr;
+    return &g_textCache.emplace(std::move(key), entry).first->second;
+}
+void drawText(TTF_Font* font, const std::string& text, SDL_Color color, float x, float y) {
+    const CachedText* ct = getCachedText(font, text, color); if (!ct) return;
+    SDL_FRect tr = {x, y, ct->w, ct->h}; SDL_RenderTexture(g_renderer, ct->texture, nullptr, &tr); g_prof.drawCalls++;
+}
+void drawTextCentered(TTF_Font* font, const std::string& text, SDL_Color color, float centerX, float y) {
+    const CachedText* ct = getCachedText(font, text, color); if (!ct) return;
+    SDL_FRect tr = {centerX - ct->w / 2.0f, y, ct->w, ct->h}; SDL_RenderTexture(g_renderer, ct->texture, nullptr, &tr); g_prof.drawCalls++;
+}
+const DigitAtlas* getDigitAtlas(TTF_Font* font, SDL_Color color) {
+    if (!font) return nullptr;
+    for (const auto& a : g_digitAtlases) if (a.font == font && a.color == packColor(color)) return &a;
+    SDL_Surface* glyphs[10] = {}; int totalW = 0, maxH = 0;
+    for (int d = 0; d < 10; d++) { glyphs[d] = TTF_RenderGlyph_Blended(font, (Uint32)('0' + d), color); if (glyphs[d]) { totalW += glyphs[d]->w; maxH = std::max(maxH, glyphs[d]->h); } }
+    DigitAtlas atlas = {font, packColor(color), nullptr, {}};
+    SDL_Surface* sheet = totalW > 0 ? SDL_CreateSurface(totalW, maxH, SDL_PIXELFORMAT_RGBA32) : nullptr;
+    if (sheet) {
+        SDL_FillSurfaceRect(sheet, nullptr, 0); int x = 0;
+        for (int d = 0; d < 10; d++) { if (!glyphs[d]) continue; SDL_Rect dst = {x, 0, glyphs[d]->w, glyphs[d]->h}; SDL_SetSurfaceBlendMode(glyphs[d], SDL_BLENDMODE_NONE); SDL_BlitSurface(glyphs[d], nullptr, sheet, &dst); atlas.glyphs[d] = {(float)x, 0, (float)dst.w, (float)dst.h}; x += dst.w; }
+        atlas.texture = SDL_CreateTextureFromSurface(g_renderer, sheet); g_prof.texturesCreated++;
+        SDL_DestroySurface(sheet);
+    }
+    for (SDL_Surface* g : glyphs) if (g) SDL_DestroySurface(g);
+    g_textCacheMisses++;
+    g_digitAtlases.push_back(atlas);
+    return &g_digitAtlases.back();
+}
+void drawNumber(TTF_Font* font, Uint32 value, SDL_Color color, float x, float y) {
+    const DigitAtlas* a = getDigitAtlas(font, color); if (!a || !a->texture) return;
+    char digits[16]; int n = 0; do { digits[n++] = (char)(value % 10); value /= 10; } while (value > 0);
+    while (n > 0) { const SDL_FRect& src = a->glyphs[(int)digits[--n]]; SDL_FRect dst = {x, y, src.w, src.h}; SDL_RenderTexture(g_renderer, a->texture, &src, &dst); g_prof.drawCalls++; x += src.w; }
+    g_digitAtlasDraws++;
+}
+void trimTextCache() {
+    if (g_frameCounter % TEXT_CACHE_EVICT_FRAMES != 0) return;
+    for (auto it = g_textCache.begin(); it != g_textCache.end();) {
+        if (g_frameCounter - it->second.lastUsedFrame > TEXT_CACHE_EVICT_FRAMES) { SDL_DestroyTexture(it->second.texture); it = g_textCache.erase(it); } else ++it;
+    }
+}
+void clearTextCache() {
+    for (auto& e : g_textCache) SDL_DestroyTexture(e.second.texture);
+    for (auto& a : g_digitAtlases) if (a.texture) SDL_DestroyTexture(a.texture);
+    g_textCache.clear(); g_digitAtlases.clear();
 }
 
 // Render Functions
+// Asset Loading: PNGs are decoded on worker threads with IMG_Load (sprites are scaled into their atlas cell
+// there too); the render thread uploads each surface as it lands and draws a progress frame in between
+struct AssetJob { const char* path; SDL_Texture** texture; int sprite; SDL_Surface* surface; std::string error; };
+struct AssetLoader {
+    std::vector<AssetJob> jobs; std::vector<std::thread> workers;
+    std::atomic<size_t> nextJob{0};
+    std::mutex doneMutex; std::vector<size_t> done; // finished job indices not yet uploaded
+    size_t uploaded = 0; SDL_Surface* atlas = nullptr;
+};
+void assetWorker(AssetLoader* loader) {
+    for (size_t i; (i = loader->nextJob++) < loader->jobs.size();) {
+        AssetJob& job = loader->jobs[i];
+        job.surface = job.sprite >= 0 ? decodeSpriteCell(job.sprite) : IMG_Load(job.path);
+        if (!job.surface) job.error = SDL_GetError();
+        std::lock_guard<std::mutex> lock(loader->doneMutex); loader->done.push_back(i);
+    }
+}
+void startAssetLoader(AssetLoader& loader) {
+    // IMAGE_BACKGROUND is the largest image and goes first, so it overlaps with everything else
+    for (int i = 0; i < IMAGE_COUNT; i++) loader.jobs.push_back({IMAGE_PATHS[i], IMAGE_TEXTURES[i], -1, nullptr, {}});
+    for (int i = 0; i < SPRITE_COUNT; i++) loader.jobs.push_back({SPRITE_PATHS[i], nullptr, i, nullptr, {}});
+    loader.atlas = createAtlasSurface();
+    const int threads = std::max(1, std::min(SDL_GetNumLogicalCPUCores(), (int)loader.jobs.size()));
+    for (int i = 0; i < threads; i++) loader.workers.emplace_back(assetWorker, &loader);
+}
+// Uploads whatever the workers have finished; returns true once every asset is in place
+bool pumpAssetLoader(AssetLoader& loader) {
+    std::vector<size_t> ready;
+    { std::lock_guard<std::mutex> lock(loader.doneMutex); ready.swap(loader.done); }
+    for (size_t i : ready) {
+        AssetJob& job = loader.jobs[i]; loader.uploaded++;
+        if (!job.surface) { std::cout << "Warning: Failed load " << job.path << ": " << job.error << "\n"; continue; }
+        if (job.sprite >= 0) { if (loader.atlas) packSpriteCell(loader.atlas, job.sprite, job.surface); }
+        else { *job.texture = SDL_CreateTextureFromSurface(g_renderer, job.surface); g_prof.texturesCreated++; if (!*job.texture) std::cout << "Warning: Failed upload " << job.path << ": " << SDL_GetError() << "\n"; }
+        SDL_DestroySurface(job.surface); job.surface = nullptr;
+    }
+    if (loader.uploaded < loader.jobs.size()) return false;
+    for (auto& w : loader.workers) w.join();
+    loader.workers.clear();
+    if (loader.atlas) { uploadSpriteAtlas(loader.atlas); SDL_DestroySurface(loader.atlas); loader.atlas = nullptr; }
+    if (g_backgroundTexture) SDL_GetTextureSize(g_backgroundTexture, &g_bgWidth, &g_bgHeight);
+    return true;
+}
+void renderLoadingFrame(const AssetLoader& loader) {
+    SDL_SetRenderDrawColor(g_renderer, 30, 30, 70, 255); SDL_RenderClear(g_renderer);
+    SDL_Color tc = {255, 255, 255, 255}; drawTextCentered(g_smallFont, "Loading...", tc, SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f - 50.0f);
+    const float progress = loader.jobs.empty() ? 1.0f : (float)loader.uploaded / (float)loader.jobs.size();
+    SDL_FRect bar = {SCREEN_WIDTH / 2.0f - 150.0f, SCREEN_HEIGHT / 2.0f, 300.0f, 16.0f}, fill = {bar.x, bar.y, bar.w * progress, bar.h};
+    SDL_SetRenderDrawColor(g_renderer, 80, 80, 120, 255); SDL_RenderFillRect(g_renderer, &bar);
+    SDL_SetRenderDrawColor(g_renderer, 255, 105, 180, 255); SDL_RenderFillRect(g_renderer, &fill);
+}
+
+// Asset Bundle: assets.uetb (built by the bundle target) is memory-mapped and its pre-decoded pixels go
+// straight into textures; the loose files above are the fallback when it is missing or stale. Stale means an
+// asset file that is present differs in size or modification time from when it was packed
+struct MappedFile {
+    const Uint8* data = nullptr; size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+};
+bool mapFile(const std::string& path, MappedFile& m) {
+#ifdef _WIN32
+    m.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size; if (!GetFileSizeEx(m.file, &size) || size.QuadPart == 0) { CloseHandle(m.file); m.file = INVALID_HANDLE_VALUE; return false; }
+    m.mapping = CreateFileMappingA(m.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    m.data = m.mapping ? (const Uint8*)MapViewOfFile(m.mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!m.data) { if (m.mapping) CloseHandle(m.mapping); CloseHandle(m.file); m.mapping = nullptr; m.file = INVALID_HANDLE_VALUE; return false; }
+    m.size = (size_t)size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY); if (fd < 0) return false;
+    struct stat st; if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (p == MAP_FAILED) return false;
+    m.data = (const Uint8*)p; m.size = (size_t)st.st_size;
+#endif
+    return true;
+}
+void unmapFile(MappedFile& m) {
+    if (!m.data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m.data); CloseHandle(m.mapping); CloseHandle(m.file); m.mapping = nullptr; m.file = INVALID_HANDLE_VALUE;
+#else
+    munmap((void*)m.data, m.size);
+#endif
+    m.data = nullptr; m.size = 0;
+}
+struct AssetBundle { MappedFile file; const BundleEntry* entries = nullptr; Uint32 entryCount = 0; };
+AssetBundle g_bundle;
+
+// Maps the bundle next to the executable, else in the working directory, and validates its table
+bool openAssetBundle() {
+    const char* base = SDL_GetBasePath();
+    if (!(base && mapFile(std::string(base) + BUNDLE_PATH, g_bundle.file)) && !mapFile(BUNDLE_PATH, g_bundle.file)) return false;
+    const MappedFile& f = g_bundle.file; BundleHeader header;
+    bool ok = f.size >= sizeof(header);
+    if (ok) { memcpy(&header, f.data, sizeof(header)); ok = memcmp(header.magic, BUNDLE_MAGIC, 4) == 0 && header.version == BUNDLE_VERSION && f.size >= sizeof(header) + (Uint64)header.entryCount * sizeof(BundleEntry); }
+    if (ok) {
+        g_bundle.entries = (const BundleEntry*)(f.data + sizeof(header)); g_bundle.entryCount = header.entryCount;
+        for (Uint32 i = 0; i < header.entryCount && ok; i++) ok = g_bundle.entries[i].offset + g_bundle.entries[i].size <= f.size;
+    }
+    if (!ok) std::cout << "Warning: Ignoring invalid asset bundle " << BUNDLE_PATH << "\n";
+    // A shipped build may carry only the bundle, so a missing source is fine; a changed one is not
+    for (Uint32 i = 0; i < g_bundle.entryCount && ok; i++) {
+        const BundleEntry& e = g_bundle.entries[i]; char name[sizeof(e.name) + 1] = {}; memcpy(name, e.name, sizeof(e.name));
+        Uint64 size; Sint64 time;
+        if (e.sourceSize == 0 || !bundleSourceStamp(name, size, time)) continue;
+        ok = size == e.sourceSize && time == e.sourceTime;
+        if (!ok) std::cout << "Warning: Asset bundle " << BUNDLE_PATH << " is out of date (" << name << " changed), loading loose files; rebuild it with the bundle target\n";
+    }
+    if (!ok) { unmapFile(g_bundle.file); g_bundle = AssetBundle(); }
+    return ok;
+}
+const BundleEntry* findBundleEntry(const char* name, BundleEntryType type) {
+    for (Uint32 i = 0; i < g_bundle.entryCount; i++) if (g_bundle.entries[i].type == type && SDL_strncmp(g_bundle.entries[i].name, name, sizeof(g_bundle.entries[i].name)) == 0) return &g_bundle.entries[i];
+    return nullptr;
+}
+SDL_Texture* createBundleTexture(const BundleEntry* e) {
+    if (!e || (Uint64)e->pitch * e->height > e->size) return nullptr;
+    SDL_Texture* t = SDL_CreateTexture(g_renderer, (SDL_PixelFormat)e->format, SDL_TEXTUREACCESS_STATIC, (int)e->width, (int)e->height);
+    if (t && !SDL_UpdateTexture(t, nullptr, g_bundle.file.data + e->offset, (int)e->pitch)) { SDL_DestroyTexture(t); t = nullptr; }
+    if (t) { SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND); g_prof.texturesCreated++; }
+    return t;
+}
+// Creates every texture from the bundle; on any missing entry it releases them again and returns false
+bool loadBundleTextures() {
+    if (!g_bundle.file.data) return false;
+    bool ok = true;
+    for (int i = 0; i < IMAGE_COUNT; i++) ok = ok && (*IMAGE_TEXTURES[i] = createBundleTexture(findBundleEntry(IMAGE_PATHS[i], BUNDLE_IMAGE))) != nullptr;
+    ok = ok && (g_atlasTexture = createBundleTexture(findBundleEntry(BUNDLE_ATLAS_NAME, BUNDLE_IMAGE))) != nullptr;
+    for (int i = 0; i < SPRITE_COUNT && ok; i++) {
+        const BundleEntry* e = findBundleEntry(SPRITE_PATHS[i], BUNDLE_SPRITE);
+        if (e) g_spriteRects[i] = {(float)e->x, (float)e->y, (float)e->width, (float)e->height}; else ok = false;
+    }
+    if (!ok) {
+        std::cout << "Warning: Asset bundle is incomplete, loading loose files\n";
+        for (SDL_Texture** t : IMAGE_TEXTURES) if (*t) { SDL_DestroyTexture(*t); *t = nullptr; }
+        if (g_atlasTexture) { SDL_DestroyTexture(g_atlasTexture); g_atlasTexture = nullptr; }
+        return false;
+    }
+    SDL_GetTextureSize(g_backgroundTexture, &g_bgWidth, &g_bgHeight);
+    return true;
+}
+// Fonts read from the mapped bundle when it carries one, else from FONT_PATH
+TTF_Font* openGameFont(float size) {
+    const BundleEntry* e = g_bundle.file.data ? findBundleEntry(FONT_PATH, BUNDLE_FONT) : nullptr;
+    if (e) return TTF_OpenFontIO(SDL_IOFromConstMem(g_bundle.file.data + e->offset, (size_t)e->size), true, size);
+    return TTF_OpenFont(FONT_PATH, size);
+}
+
 void renderRoundedButton(SDL_Renderer* renderer, const Button& btn, TTF_Font* font, SDL_Texture* bgTexture, SDL_Color bc, SDL_Color tc, bool isHovered) {
     if(!renderer||!font||!bgTexture)return;
     if (isHovered) { SDL_SetTextureColorMod(bgTexture, 255, 255, 255); SDL_SetTextureAlphaMod(bgTexture, 255); }
     else { SDL_SetTextureColorMod(bgTexture, 200, 200, 200); SDL_SetTextureAlphaMod(bgTexture, 220); }
-    SDL_RenderTexture(renderer,bgTexture,nullptr,&btn.rect);
+    SDL_RenderTexture(renderer,bgTexture,nullptr,&btn.rect); g_prof.drawCalls++;
     SDL_SetTextureColorMod(bgTexture, 255, 255, 255); SDL_SetTextureAlphaMod(bgTexture, 255);
-    SDL_Surface*s=TTF_RenderText_Blended(font,btn.text.c_str(),btn.text.length(),tc); if(!s)return;
-    SDL_Texture*t=SDL_CreateTextureFromSurface(renderer,s);
-    SDL_FRect tr={btn.rect.x+(btn.rect.w-s->w)/2.0f,btn.rect.y+(btn.rect.h-s->h)/2.0f,(float)s->w,(float)s->h};
-    SDL_RenderTexture(renderer,t,nullptr,&tr); SDL_DestroySurface(s); SDL_DestroyTexture(t);
+    const CachedText*ct=getCachedText(font,btn.text,tc); if(!ct)return;
+    SDL_FRect tr={btn.rect.x+(btn.rect.w-ct->w)/2.0f,btn.rect.y+(btn.rect.h-ct->h)/2.0f,ct->w,ct->h};
+    SDL_RenderTexture(renderer,ct->texture,nullptr,&tr); g_prof.drawCalls++;
 }
 
 // Update Functions
-void updateDamageItems(float dt) {
-    for (auto& item : g_damageItems) {
-        if (!item.isCollected) {
-            float currentSpeed = item.baseVelocityX * g_damageItemSpeedMultiplier;
-            item.rect.x += currentSpeed * dt;
-            if (item.baseVelocityX > 0 && item.rect.x >= item.startX + item.moveRange) { item.rect.x = item.startX + item.moveRange; item.baseVelocityX = -item.baseVelocityX; }
-            else if (item.baseVelocityX < 0 && item.rect.x <= item.startX - item.moveRange) { item.rect.x = item.startX - item.moveRange; item.baseVelocityX = -item.baseVelocityX; }
-            item.velocityX = item.baseVelocityX;
+void worldUpdateDamageItems(World& w, float dt) {
+    for (auto& chunk : w.track.chunks) { EntityStore& e = chunk.entities; patrolKernel(e, e.begin(KIND_DAMAGE_ITEM), e.end(KIND_DAMAGE_ITEM), w.damageItemSpeedMultiplier * dt); }
+}
+void worldEmit(World& w, WorldEvents type, float x, float y, int value = 0) { w.events |= type; w.eventLog.push_back({type, x, y, value}); }
+void worldCollect(World& w, int points, float x, float y) {
+    w.itemCount++; w.totalItemCount++; w.score += points; worldEmit(w, WORLD_EVENT_PICKUP, x, y, points);
+    if (w.itemCount >= w.difficulty.itemsPerLevel && w.level < MAX_LEVEL) {
+        w.level++; w.itemCount = 0;
+        w.maxMoveSpeed *= w.difficulty.speedRamp; w.damageItemSpeedMultiplier *= w.difficulty.damageSpeedRamp;
+        worldEmit(w, WORLD_EVENT_LEVEL_UP, w.player.rect.x + w.player.rect.w / 2.0f, w.player.rect.y, w.level);
+    }
+}
+// Swept AABB: the earliest time in [0, 1] at which box a, moving by (dx, dy), overlaps box b, or -1 if it never
+// does. Touching edges do not overlap, as in checkRectCollision; boxes that already overlap return 0
+float sweptAABB(const SDL_FRect& a, float dx, float dy, const SDL_FRect& b) {
+    const float pos[2] = {a.x, a.y}, size[2] = {a.w, a.h}, d[2] = {dx, dy}, bPos[2] = {b.x, b.y}, bSize[2] = {b.w, b.h};
+    float tEnter = 0.0f, tExit = 1.0f;
+    for (int k = 0; k < 2; k++) {
+        if (d[k] == 0.0f) { if (!(pos[k] < bPos[k] + bSize[k] && pos[k] + size[k] > bPos[k])) return -1.0f; continue; }
+        float t0 = (bPos[k] - (pos[k] + size[k])) / d[k], t1 = (bPos[k] + bSize[k] - pos[k]) / d[k];
+        if (t0 > t1) std::swap(t0, t1);
+        tEnter = std::max(tEnter, t0); tExit = std::min(tExit, t1);
+    }
+    return tEnter < tExit ? tEnter : -1.0f;
+}
+SDL_FRect sweptBounds(const SDL_FRect& a, float dx, float dy) { return {std::min(a.x, a.x + dx), std::min(a.y, a.y + dy), a.w + std::fabs(dx), a.h + std::fabs(dy)}; }
+// First obstacle box r reaches moving by (dx, dy). A vertical move only meets tops r starts above and bottoms
+// it starts below (within a pixel); running into a side is the horizontal move's job
+SweepHit sweepObstacles(World& w, const SDL_FRect& r, float dx, float dy) {
+    SweepHit best = {2.0f, nullptr, 0};
+    const SDL_FRect bounds = sweptBounds(r, dx, dy);
+    for (TrackChunk* chunk : chunksNear(w.track, bounds.x, bounds.x + bounds.w)) {
+        EntityStore& e = chunk->entities;
+        w.overlapHits.clear(); overlapKernel(e, e.begin(KIND_OBSTACLE), e.end(KIND_OBSTACLE), bounds, w.overlapHits);
+        for (Uint32 i : w.overlapHits) {
+            const SDL_FRect obs = e.rect(i);
+            if ((dy > 0 && r.y + r.h > obs.y + 1.0f) || (dy < 0 && r.y < obs.y + obs.h - 1.0f)) continue;
+            const float t = sweptAABB(r, dx, dy, obs);
+            if (t >= 0.0f && t < best.t) best = {t, &e, i};
         }
     }
+    return best;
+}
+// Returns true when the hit was fatal
+bool worldHurt(World& w, DeathCause cause, float x, float y) {
+    w.player.hp -= 20; worldEmit(w, WORLD_EVENT_DAMAGE, x, y, -20);
+    if (w.player.hp > 0) return false;
+    w.player.hp = 0; w.outcome = WORLD_DIED; w.deathCause = cause;
+    return true;
 }
 
-void updatePlayer(float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHeld) {
-    const float max_dt = 0.033f;
-    if (dt > max_dt) dt = max_dt;
+// Scores every obstacle the player's centre has passed. The cursor walks the obstacles chunk by chunk and
+// stops at the first one still ahead, so each is visited once per track
+void advancePassCursor(World& w) {
+    Track& track = w.track;
+    const float centerX = w.player.rect.x + w.player.rect.w / 2;
+    while (TrackChunk* chunk = trackChunk(track, std::max(track.passChunk, track.firstChunk))) {
+        if (track.passChunk < track.firstChunk) {
+            track.passChunk = track.firstChunk;
+            track.passIndex = 0;
+        }
+        EntityStore& e = chunk->entities;
+        if (track.passIndex >= e.end(KIND_OBSTACLE)) {
+            if (track.passChunk + 1 >= track.streams[KIND_OBSTACLE].nextChunk) break; // the next chunk is not streamed yet
+            track.passChunk++;
+            track.passIndex = 0;
+            continue;
+        }
+        const size_t i = track.passIndex;
+        if (centerX <= e.x[i] + e.w[i]) break;
+        if (!(e.flags[i] & ENTITY_PASSED)) {
+            e.flags[i] |= ENTITY_PASSED;
+            w.score += 10;
+        }
+        track.passIndex++;
+    }
+}
+// Fills w.sweepHits with every item the player's box passed through this step, ordered by time of impact
+void gatherPickupSweep(World& w) {
+    const SDL_FRect from = w.player.prevRect;
+    const float mx = w.player.rect.x - from.x, my = w.player.rect.y - from.y;
+    const SDL_FRect reach = sweptBounds(from, mx, my);
+    auto earlier = [](const SweepHit& a, const SweepHit& b) { return a.t < b.t; };
+    w.sweepHits.clear();
+    for (TrackChunk* chunk : chunksNear(w.track, reach.x, reach.x + reach.w)) {
+        EntityStore& e = chunk->entities;
+        w.overlapHits.clear();
+        overlapKernel(e, e.begin(KIND_COLLECTIBLE), e.end(KIND_MYSTERY_ITEM), reach, w.overlapHits);
+        for (Uint32 i : w.overlapHits) {
+            if (e.flags[i] & ENTITY_COLLECTED) continue;
+            const SweepHit hit = {sweptAABB(from, mx, my, e.rect(i)), &e, i};
+            if (hit.t >= 0.0f) w.sweepHits.insert(std::upper_bound(w.sweepHits.begin(), w.sweepHits.end(), hit, earlier), hit);
+        }
+    }
+}
+// Collects the swept items in order. Returns true when one of them ends the run, leaving the rest untouched
+bool resolvePickupSweep(World& w) {
+    Player& player = w.player;
+    for (const SweepHit& hit : w.sweepHits) {
+        EntityStore& e = *hit.store;
+        const Uint32 i = hit.index;
+        if (e.flags[i] & ENTITY_COLLECTED) continue;
+        e.flags[i] |= ENTITY_COLLECTED;
+        const float ix = e.x[i] + e.w[i] / 2.0f, iy = e.y[i] + e.h[i] / 2.0f;
+        if (i < e.end(KIND_COLLECTIBLE)) {
+            worldCollect(w, 5, ix, iy);
+        } else if (i < e.end(KIND_DAMAGE_ITEM)) {
+            e.velocityX[i] = 0.0f;
+            if (worldHurt(w, DEATH_DAMAGE_ITEM, ix, iy)) return true;
+        } else {
+            switch (w.rng.range(3)) {
+            case 0:
+                player.hp = std::min(player.hp + 20, 100);
+                worldEmit(w, WORLD_EVENT_HEAL, ix, iy, 20);
+                break;
+            case 1:
+                worldCollect(w, 20, ix, iy);
+                break;
+            case 2:
+                if (worldHurt(w, DEATH_MYSTERY_ITEM, ix, iy)) return true;
+                break;
+            }
+        }
+    }
+    return false;
+}
 
+void worldUpdatePlayer(World& w, float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHeld) {
+    Player& player = w.player;
     if (player.coyoteTimer > 0.0f) player.coyoteTimer -= dt;
     if (player.jumpBufferTimer > 0.0f) player.jumpBufferTimer -= dt;
 
@@ -229,8 +937,8 @@ void updatePlayer(float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHe
 
     // Horizontal Movement
     float targetVelocityX = 0.0f;
-    if (isMovingRight) targetVelocityX = g_maxMoveSpeed;
-    else if (isMovingLeft) targetVelocityX = -g_maxMoveSpeed;
+    if (isMovingRight) targetVelocityX = w.maxMoveSpeed;
+    else if (isMovingLeft) targetVelocityX = -w.maxMoveSpeed;
     float acceleration = MOVE_ACCELERATION;
     float deceleration = player.onGround ? GROUND_DECELERATION : AIR_DECELERATION;
     float currentAccel = (targetVelocityX != 0.0f) ? acceleration : deceleration;
@@ -265,58 +973,49 @@ void updatePlayer(float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHe
         }
     }
 
-    // Apply X Velocity & Collision
-    player.rect.x += player.velocityX * dt;
-    for (const auto& obs : g_obstacles) {
-        if (player.rect.x + player.rect.w > obs.rect.x && player.rect.x < obs.rect.x + obs.rect.w &&
-            player.rect.y + player.rect.h > obs.rect.y && player.rect.y < obs.rect.y + obs.rect.h)
-        {
-            if (checkRectCollision(player.rect, obs.rect)) {
-                if (player.velocityX > 0) { player.rect.x = obs.rect.x - player.rect.w; }
-                else if (player.velocityX < 0) { player.rect.x = obs.rect.x + obs.rect.w; }
-                player.velocityX = 0;
-            }
-        }
+    // Apply X Velocity & Collision: the move is swept, so it stops at the first obstacle on the way at any dt
+    const float dx = player.velocityX * dt;
+    const SweepHit hitX = sweepObstacles(w, player.rect, dx, 0.0f);
+    if (hitX.store) {
+        const SDL_FRect obs = hitX.store->rect(hitX.index);
+        if (dx > 0) { player.rect.x = obs.x - player.rect.w; }
+        else if (dx < 0) { player.rect.x = obs.x + obs.w; }
+        player.velocityX = 0; w.blockedVariant = hitX.store->variant[hitX.index]; w.blockedTick = w.ticks;
+    } else {
+        player.rect.x += dx;
     }
 
     // Apply Y Velocity & Collision
+    const float fallSpeed = player.velocityY;
+    const float dy = player.velocityY * dt;
+    const SweepHit hitY = sweepObstacles(w, player.rect, 0.0f, dy);
     player.onGround = false;
-    player.rect.y += player.velocityY * dt;
+    player.rect.y += dy;
+    if (hitY.store) {
+        const SDL_FRect obs = hitY.store->rect(hitY.index);
+        if (dy > 0) {
+            player.rect.y = obs.y - player.rect.h;
+            player.velocityY = 0;
+            player.onGround = true;
+        } else {
+            player.rect.y = obs.y + obs.h;
+            player.velocityY = 0;
+            player.coyoteTimer = 0.0f;
+            player.canDoubleJump = false;
+        }
+    }
     if (player.rect.y + player.rect.h >= GROUND_Y) {
         player.rect.y = GROUND_Y - player.rect.h;
         if (player.velocityY > 0) player.velocityY = 0;
         player.onGround = true;
     }
-    for (const auto& obs : g_obstacles) {
-        if (player.rect.x + player.rect.w > obs.rect.x && player.rect.x < obs.rect.x + obs.rect.w &&
-            player.rect.y + player.rect.h > obs.rect.y && player.rect.y < obs.rect.y + obs.rect.h)
-        {
-             if (checkRectCollision(player.rect, obs.rect)) {
-                if (player.velocityY > 0) {
-                    float prevBottom = (player.rect.y - player.velocityY * dt) + player.rect.h;
-                    if (prevBottom <= obs.rect.y + 1.0f) {
-                        player.rect.y = obs.rect.y - player.rect.h;
-                        player.velocityY = 0;
-                        player.onGround = true;
-                    }
-                } else if (player.velocityY < 0) {
-                    float prevTop = player.rect.y - player.velocityY * dt;
-                    if (prevTop >= obs.rect.y + obs.rect.h - 1.0f) {
-                        player.rect.y = obs.rect.y + obs.rect.h;
-                        player.velocityY = 0;
-                        player.coyoteTimer = 0.0f;
-                        player.canDoubleJump = false;
-                    }
-                }
-            }
-        }
-    }
 
     // Update States Post-Collision
     if (player.onGround) {
         if (!wasOnGround) {
              player.coyoteTimer = COYOTE_TIME_DURATION;
              player.canDoubleJump = true;
+             worldEmit(w, WORLD_EVENT_LAND, player.rect.x + player.rect.w / 2.0f, player.rect.y + player.rect.h, (int)fallSpeed);
         }
     } else {
         if (wasOnGround && player.velocityY >= 0) {
@@ -325,93 +1024,959 @@ void updatePlayer(float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHe
     }
 
     // Other Game Logic
-    if (player.rect.x < g_cameraX) { player.rect.x = g_cameraX; if (player.velocityX < 0) player.velocityX = 0; }
-    for (auto& obs : g_obstacles) { if (!obs.isPassed && player.rect.x + player.rect.w / 2 > obs.rect.x + obs.rect.w) { obs.isPassed = true; g_score += 10; } }
-    for (auto& item : g_collectibles) { if (!item.isCollected && checkRectCollision(player.rect, item.rect)) { item.isCollected = true; g_itemCount++; g_totalItemCount++; g_score += 5; if (g_itemCount >= ITEMS_PER_LEVEL && g_level < MAX_LEVEL) { g_level++; g_itemCount = 0; g_maxMoveSpeed *= 1.05f; g_damageItemSpeedMultiplier *= 1.1f; if(static_cast<size_t>(g_level) < LEVEL_NAMES.size()) { /* Level up */ } g_playerIsFlashing = true; g_flashStartTime = SDL_GetTicks(); g_levelUpTextStartTime = SDL_GetTicks(); if(g_levelUpTextTexture){float tw,th;SDL_GetTextureSize(g_levelUpTextTexture, &tw, &th); g_levelUpTextRect = {player.rect.x + (player.rect.w - tw) / 2.0f, player.rect.y - th, tw, th};} } } }
-    for (auto& item : g_damageItems) { if (!item.isCollected && checkRectCollision(player.rect, item.rect)) { item.isCollected = true; player.hp -= 20; if (player.hp <= 0) { player.hp = 0; if(g_gameInProgress) { addHighScore(g_totalItemCount); g_gameInProgress = false; } g_currentScene = Scene::GAME_OVER; return; } } }
-    for (auto& item : g_mysteryItems) { if (!item.isCollected && checkRectCollision(player.rect, item.rect)) { item.isCollected = true; int effect = rand() % 3; switch (effect) { case 0: player.hp += 20; if (player.hp > 100) player.hp = 100; break; case 1: g_itemCount++; g_totalItemCount++; g_score += 20; if (g_itemCount >= ITEMS_PER_LEVEL && g_level < MAX_LEVEL) { g_level++; g_itemCount = 0; g_maxMoveSpeed *= 1.05f; g_damageItemSpeedMultiplier *= 1.1f; if(static_cast<size_t>(g_level) < LEVEL_NAMES.size()) { /* Level up */ } g_playerIsFlashing = true; g_flashStartTime = SDL_GetTicks(); g_levelUpTextStartTime = SDL_GetTicks(); if(g_levelUpTextTexture){float tw,th;SDL_GetTextureSize(g_levelUpTextTexture, &tw, &th); g_levelUpTextRect = {player.rect.x + (player.rect.w - tw) / 2.0f, player.rect.y - th, tw, th};} } break; case 2: player.hp -= 20; if (player.hp <= 0) { player.hp = 0; if(g_gameInProgress) { addHighScore(g_totalItemCount); g_gameInProgress = false; } g_currentScene = Scene::GAME_OVER; return; } break; } } }
-    if (player.rect.x >= TRACK_LENGTH) { if(g_gameInProgress) { addHighScore(g_totalItemCount); g_gameInProgress = false; } g_currentScene = Scene::FINISH; return; }
-    if (player.rect.y > SCREEN_HEIGHT + player.rect.h * 2) { if(g_gameInProgress) { addHighScore(g_totalItemCount); g_gameInProgress = false; } g_currentScene = Scene::GAME_OVER; return; }
-    g_cameraX = player.rect.x - 200; if (g_cameraX < 0) g_cameraX = 0;
+    Track& track = w.track;
+    if (player.rect.x < w.cameraX) { player.rect.x = w.cameraX; if (player.velocityX < 0) player.velocityX = 0; }
+    advancePassCursor(w);
+    gatherPickupSweep(w);
+    if (resolvePickupSweep(w)) return;
+    if (!track.endless && player.rect.x >= TRACK_LENGTH) { w.outcome = WORLD_FINISHED; return; }
+    if (player.rect.y > SCREEN_HEIGHT + player.rect.h * 2) { w.outcome = WORLD_DIED; w.deathCause = DEATH_FALL; return; }
+    w.cameraX = std::max(w.cameraX, player.rect.x - 200); // the camera only moves forward, so chunks behind it can be recycled
+}
+
+// One fixed simulation step; the caller reacts to w.events and w.outcome
+void worldStep(World& w, float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHeld) {
+    w.player.prevRect = w.player.rect; w.prevCameraX = w.cameraX; w.events = 0; w.eventLog.clear();
+    { ProfScope ps(PROF_SIM_DAMAGE); worldUpdateDamageItems(w, dt); }
+    { ProfScope ps(PROF_SIM_PLAYER); worldUpdatePlayer(w, dt, isMovingLeft, isMovingRight, isJumpHeld); }
+    { ProfScope ps(PROF_SIM_STREAM); Uint64 tests = w.track.overlapTests; trackStream(w.track, w.cameraX); g_prof.entitiesTested += (Uint32)(w.track.overlapTests - tests); }
+    w.ticks++;
+}
+// Resets everything but the track and difficulty; worldGenerate (or a prepared track) supplies the track
+void worldReset(World& w, Uint64 seed) {
+    w.player = Player(); w.player.rect.x = 100; w.player.rect.y = 300; w.player.prevRect = w.player.rect;
+    w.rng = Rng(seed, SESSION_RNG_STREAM);
+    w.cameraX = 0; w.prevCameraX = 0; w.score = 0; w.level = 1; w.itemCount = 0; w.totalItemCount = 0;
+    w.maxMoveSpeed = MAX_MOVE_SPEED; w.damageItemSpeedMultiplier = 1.0f;
+    w.ticks = 0; w.outcome = WORLD_RUNNING; w.deathCause = DEATH_NONE; w.blockedVariant = -1; w.blockedTick = 0; w.events = 0; w.eventLog.clear();
+}
+void worldGenerate(World& w, Uint64 seed, bool endless) { trackReset(w.track, seed, endless); trackStream(w.track, w.cameraX); }
+
+// Effects: cosmetic particles and floating text spawned from World events. Particles live in a fixed
+// structure-of-arrays pool and draw as one untextured geometry batch; once the pool or the per-frame spawn
+// budget is exhausted new particles are dropped, so a burst of events cannot blow the frame budget
+const int PARTICLE_CAP = 1024;
+const int PARTICLE_SPAWN_BUDGET = 256; // per rendered frame
+const int POPUP_CAP = 16;
+struct ParticlePool {
+    float x[PARTICLE_CAP], y[PARTICLE_CAP], vx[PARTICLE_CAP], vy[PARTICLE_CAP], gravity[PARTICLE_CAP];
+    float life[PARTICLE_CAP], maxLife[PARTICLE_CAP], size[PARTICLE_CAP];
+    SDL_FColor color[PARTICLE_CAP];
+    int count = 0, spawnBudget = PARTICLE_SPAWN_BUDGET;
+    Uint32 dropped = 0;
+    SDL_Vertex vertices[PARTICLE_CAP * 4]; int indices[PARTICLE_CAP * 6]; // draw buffers, indices built once
+};
+struct Popup { std::string text; TTF_Font* font; SDL_Color color; float x, y, life, maxLife; };
+ParticlePool g_particles;
+Popup g_popups[POPUP_CAP]; int g_popupCount = 0;
+Rng g_effectsRng(0x5eed, 65); // effects never touch the session RNG, so they cannot change a replay
+
+inline float effectsRandom(float lo, float hi) { return lo + (hi - lo) * (float)(g_effectsRng.next() >> 8) * (1.0f / 16777216.0f); }
+void initParticles() {
+    static const int quad[6] = {0, 1, 2, 0, 2, 3};
+    for (int p = 0; p < PARTICLE_CAP; p++) for (int k = 0; k < 6; k++) g_particles.indices[p * 6 + k] = p * 4 + quad[k];
+}
+void spawnParticles(int n, float x, float y, SDL_FColor c, float speedLo, float speedHi, float upBias, float gravity, float lifeLo, float lifeHi, float sizeLo, float sizeHi) {
+    ParticlePool& pp = g_particles;
+    for (int k = 0; k < n; k++) {
+        if (pp.count >= PARTICLE_CAP || pp.spawnBudget <= 0) { pp.dropped += n - k; return; }
+        const int i = pp.count++; pp.spawnBudget--;
+        const float angle = effectsRandom(0.0f, 6.2831853f), speed = effectsRandom(speedLo, speedHi);
+        pp.x[i] = x; pp.y[i] = y; pp.vx[i] = cosf(angle) * speed; pp.vy[i] = sinf(angle) * speed - upBias; pp.gravity[i] = gravity;
+        pp.life[i] = pp.maxLife[i] = effectsRandom(lifeLo, lifeHi); pp.size[i] = effectsRandom(sizeLo, sizeHi); pp.color[i] = c;
+    }
+}
+void spawnPopup(TTF_Font* font, const std::string& text, SDL_Color color, float x, float y, float life) {
+    if (g_popupCount >= POPUP_CAP) { for (int i = 1; i < POPUP_CAP; i++) g_popups[i - 1] = g_popups[i]; g_popupCount--; } // oldest gives way
+    g_popups[g_popupCount++] = {text, font, color, x, y, life, life};
+}
+void spawnEventEffects(const WorldEvent& ev) {
+    switch (ev.type) {
+    case WORLD_EVENT_PICKUP:
+        spawnParticles(ev.value > 5 ? 20 : 12, ev.x, ev.y, {1.0f, 0.85f, 0.2f, 1.0f}, 60.0f, 220.0f, 60.0f, 300.0f, 0.35f, 0.7f, 3.0f, 6.0f);
+        spawnPopup(g_smallFont, "+" + std::to_string(ev.value), {255, 235, 120, 255}, ev.x, ev.y - 30.0f, 0.8f); break;
+    case WORLD_EVENT_DAMAGE:
+        spawnParticles(24, ev.x, ev.y, {0.95f, 0.25f, 0.15f, 1.0f}, 150.0f, 380.0f, 120.0f, 900.0f, 0.3f, 0.6f, 4.0f, 8.0f);
+        spawnPopup(g_smallFont, std::to_string(ev.value), {255, 80, 60, 255}, ev.x, ev.y - 30.0f, 0.8f); break;
+    case WORLD_EVENT_HEAL:
+        spawnParticles(14, ev.x, ev.y, {0.3f, 0.95f, 0.4f, 1.0f}, 30.0f, 90.0f, 90.0f, -60.0f, 0.5f, 0.9f, 3.0f, 6.0f);
+        spawnPopup(g_smallFont, "+" + std::to_string(ev.value) + " HP", {120, 255, 140, 255}, ev.x, ev.y - 30.0f, 0.8f); break;
+    case WORLD_EVENT_LAND:
+        if (ev.value < 500) break; // soft landings raise no dust
+        for (int side = -1; side <= 1; side += 2) spawnParticles(4, ev.x + side * 30.0f, ev.y - 4.0f, {0.75f, 0.7f, 0.6f, 0.8f}, 20.0f, 80.0f, 40.0f, 150.0f, 0.25f, 0.45f, 4.0f, 9.0f);
+        break;
+    case WORLD_EVENT_LEVEL_UP:
+        spawnParticles(40, ev.x, ev.y, {1.0f, 0.84f, 0.0f, 1.0f}, 100.0f, 320.0f, 150.0f, 400.0f, 0.6f, 1.2f, 4.0f, 8.0f);
+        spawnPopup(g_font, "LEVEL UP!", {255, 215, 0, 255}, ev.x, ev.y - 60.0f, 2.0f);
+        g_playerIsFlashing = true; g_flashStartTime = SDL_GetTicks(); break;
+    }
+}
+void updateEffects(float dt) {
+    ParticlePool& pp = g_particles; pp.spawnBudget = PARTICLE_SPAWN_BUDGET;
+    for (int i = 0; i < pp.count;) {
+        pp.life[i] -= dt;
+        if (pp.life[i] <= 0.0f) { // swap the last particle in
+            const int j = --pp.count;
+            pp.x[i] = pp.x[j]; pp.y[i] = pp.y[j]; pp.vx[i] = pp.vx[j]; pp.vy[i] = pp.vy[j]; pp.gravity[i] = pp.gravity[j];
+            pp.life[i] = pp.life[j]; pp.maxLife[i] = pp.maxLife[j]; pp.size[i] = pp.size[j]; pp.color[i] = pp.color[j];
+            continue;
+        }
+        pp.vy[i] += pp.gravity[i] * dt; pp.x[i] += pp.vx[i] * dt; pp.y[i] += pp.vy[i] * dt;
+        i++;
+    }
+    int live = 0;
+    for (int i = 0; i < g_popupCount; i++) { Popup& p = g_popups[i]; p.life -= dt; p.y -= 50.0f * dt; if (p.life > 0.0f) { if (live != i) g_popups[live] = std::move(p); live++; } }
+    g_popupCount = live;
+}
+void clearEffects() { g_particles.count = 0; g_popupCount = 0; }
+void drawParticles(float camX) {
+    ParticlePool& pp = g_particles; g_prof.particles = (Uint32)pp.count;
+    if (pp.count == 0) return;
+    for (int i = 0; i < pp.count; i++) {
+        const float t = pp.life[i] / pp.maxLife[i], half = pp.size[i] * (0.5f + 0.5f * t) * 0.5f, cx = pp.x[i] - camX, cy = pp.y[i];
+        SDL_FColor c = pp.color[i]; c.a *= t;
+        SDL_Vertex* v = &pp.vertices[i * 4];
+        v[0] = {{cx - half, cy - half}, c, {0, 0}}; v[1] = {{cx + half, cy - half}, c, {0, 0}};
+        v[2] = {{cx + half, cy + half}, c, {0, 0}}; v[3] = {{cx - half, cy + half}, c, {0, 0}};
+    }
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE; SDL_GetRenderDrawBlendMode(g_renderer, &blend); SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(g_renderer, nullptr, pp.vertices, pp.count * 4, pp.indices, pp.count * 6); g_prof.drawCalls++;
+    SDL_SetRenderDrawBlendMode(g_renderer, blend);
+}
+void drawPopups(float camX) {
+    for (int i = 0; i < g_popupCount; i++) {
+        const Popup& p = g_popups[i]; const CachedText* ct = getCachedText(p.font, p.text, p.color); if (!ct) continue;
+        SDL_SetTextureAlphaMod(ct->texture, (Uint8)(255.0f * std::min(1.0f, 2.0f * p.life / p.maxLife)));
+        SDL_FRect r = {p.x - camX - ct->w / 2.0f, p.y - ct->h / 2.0f, ct->w, ct->h}; SDL_RenderTexture(g_renderer, ct->texture, nullptr, &r); g_prof.drawCalls++;
+        SDL_SetTextureAlphaMod(ct->texture, 255);
+    }
+}
+
+// Render Snapshots: everything a frame draws, copied out of the World after a batch of ticks. The sim thread
+// publishes them through a lock-free triple buffer, so drawing never waits on simulation or vice versa
+enum SnapshotSpriteFlags : Uint8 { SNAPSHOT_BOB = 1 };
+struct SnapshotSprite { SpriteId sprite; Uint8 flags; float prevX; SDL_FRect rect; }; // world space
+const int SNAPSHOT_EVENT_RING = 64;
+struct RenderSnapshot {
+    Uint64 tickNS = 0; // when the latest tick was due; the previous state is one SIM_DT_NS earlier
+    SDL_FRect playerPrev = {}, player = {}; float prevCameraX = 0.0f, cameraX = 0.0f;
+    int hp = 100, totalItemCount = 0, level = 1; WorldOutcome outcome = WORLD_RUNNING;
+    std::vector<SnapshotSprite> sprites;
+    std::vector<WorldEvent> events; Uint64 eventsEnd = 0; // the latest events, oldest first; eventsEnd counts all published so far
+};
+// One writer and one reader; each owns a slot and swaps it with the shared middle one. The dirty bit
+// marks a middle slot the reader has not taken yet, so the reader always gets the newest complete snapshot
+struct SnapshotBuffer {
+    static const Uint32 DIRTY = 4;
+    RenderSnapshot slots[3];
+    std::atomic<Uint32> middle{1};
+    Uint32 back = 0, front = 2;
+    RenderSnapshot& writeSlot() { return slots[back]; }
+    void publish() { back = middle.exchange(back | DIRTY, std::memory_order_acq_rel) & ~DIRTY; }
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~DIRTY;
+        return true;
+    }
+    const RenderSnapshot& read() const { return slots[front]; }
+};
+SnapshotBuffer g_snapshots;
+WorldEvent g_eventRing[SNAPSHOT_EVENT_RING]; Uint64 g_eventCount = 0; // written by whichever thread runs the sim
+Uint64 g_eventsSeen = 0; // render thread
+
+void captureSnapshot(World& w, Uint64 tickNS, RenderSnapshot& s) {
+    s.tickNS = tickNS; s.playerPrev = w.player.prevRect; s.player = w.player.rect; s.prevCameraX = w.prevCameraX; s.cameraX = w.cameraX;
+    s.hp = w.player.hp; s.totalItemCount = w.totalItemCount; s.level = w.level; s.outcome = w.outcome;
+    s.sprites.clear();
+    const float viewX0 = std::min(w.prevCameraX, w.cameraX), viewX1 = std::max(w.prevCameraX, w.cameraX) + SCREEN_WIDTH;
+    ChunkSpan view = chunksNear(w.track, viewX0, viewX1);
+    for(TrackChunk*chunk:view){ const EntityStore&e=chunk->entities; for(Uint32 i=e.begin(KIND_OBSTACLE);i<e.end(KIND_OBSTACLE);i++) s.sprites.push_back({SPRITE_OBSTACLE,0,e.x[i],e.rect(i)}); }
+    for(TrackChunk*chunk:view){ const EntityStore&e=chunk->entities; for(Uint32 i=e.begin(KIND_COLLECTIBLE);i<e.end(KIND_COLLECTIBLE);i++) if(!(e.flags[i]&ENTITY_COLLECTED)) s.sprites.push_back({SPRITE_COLLECTIBLE,SNAPSHOT_BOB,e.x[i],e.rect(i)}); }
+    for(TrackChunk*chunk:view){ const EntityStore&e=chunk->entities; for(Uint32 i=e.begin(KIND_DAMAGE_ITEM);i<e.end(KIND_DAMAGE_ITEM);i++) if(!(e.flags[i]&ENTITY_COLLECTED)) s.sprites.push_back({SPRITE_DAMAGE_ITEM,0,e.prevX[i],e.rect(i)}); }
+    for(TrackChunk*chunk:view){ const EntityStore&e=chunk->entities; for(Uint32 i=e.begin(KIND_MYSTERY_ITEM);i<e.end(KIND_MYSTERY_ITEM);i++) if(!(e.flags[i]&ENTITY_COLLECTED)) s.sprites.push_back({SPRITE_MYSTERY_ITEM,SNAPSHOT_BOB,e.x[i],e.rect(i)}); }
+    s.events.clear();
+    for (Uint64 id = g_eventCount > SNAPSHOT_EVENT_RING ? g_eventCount - SNAPSHOT_EVENT_RING : 0; id < g_eventCount; id++) s.events.push_back(g_eventRing[id % SNAPSHOT_EVENT_RING]);
+    s.eventsEnd = g_eventCount;
+}
+void publishSnapshot(World& w, Uint64 tickNS) { captureSnapshot(w, tickNS, g_snapshots.writeSlot()); g_snapshots.publish(); }
+// Takes the newest snapshot, if any, and starts effects for the events it has not seen yet
+void acquireSnapshot() {
+    if (!g_snapshots.acquire()) return;
+    const RenderSnapshot& s = g_snapshots.read();
+    const Uint64 first = s.eventsEnd - s.events.size();
+    for (Uint64 id = std::max(first, g_eventsSeen); id < s.eventsEnd; id++) spawnEventEffects(s.events[id - first]);
+    g_eventsSeen = s.eventsEnd;
 }
 
 // Draw Functions
-void drawGameWorld() {
-    SDL_SetRenderDrawColor(g_renderer, 135, 206, 250, 255); SDL_RenderClear(g_renderer);
-    if(g_backgroundTexture&&g_bgWidth>0&&g_bgHeight>0){ float p=0.5f,s=(float)SCREEN_HEIGHT/g_bgHeight,sw=g_bgWidth*s,o=fmod(g_cameraX*p,sw); SDL_FRect r1={-o,0,sw,(float)SCREEN_HEIGHT},r2={-o+sw,0,sw,(float)SCREEN_HEIGHT}; SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r1); SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r2); }
-    for(const auto&o:g_obstacles){ SDL_FRect r={o.rect.x-g_cameraX,o.rect.y,o.rect.w,o.rect.h}; if(g_obstacleTexture)SDL_RenderTexture(g_renderer,g_obstacleTexture,nullptr,&r); }
-    for(const auto&i:g_collectibles){ if(!i.isCollected){ SDL_FRect r={i.rect.x-g_cameraX,i.rect.y,i.rect.w,i.rect.h}; r.y += sinf((float)SDL_GetTicks() / 350.0f + i.rect.x) * 5.0f; if(g_collectibleTexture)SDL_RenderTexture(g_renderer,g_collectibleTexture,nullptr,&r); } }
-    for(const auto&i:g_damageItems){ if(!i.isCollected){ SDL_FRect r={i.rect.x-g_cameraX,i.rect.y,i.rect.w,i.rect.h}; if(g_damageItemTexture)SDL_RenderTexture(g_renderer,g_damageItemTexture,nullptr,&r); } }
-    for(const auto&i:g_mysteryItems){ if(!i.isCollected){ SDL_FRect r={i.rect.x-g_cameraX,i.rect.y,i.rect.w,i.rect.h}; r.y += sinf((float)SDL_GetTicks() / 350.0f + i.rect.x) * 5.0f; if(g_mysteryItemTexture)SDL_RenderTexture(g_renderer,g_mysteryItemTexture,nullptr,&r); } }
-    if (g_playerIsFlashing) { Uint32 elapsed = SDL_GetTicks() - g_flashStartTime; if (elapsed >= FLASH_DURATION) { g_playerIsFlashing = false; SDL_SetTextureAlphaMod(g_player, 255); } else { if ((elapsed / FLASH_INTERVAL) % 2 == 0) SDL_SetTextureAlphaMod(g_player, 100); else SDL_SetTextureAlphaMod(g_player, 255); } } else { SDL_SetTextureAlphaMod(g_player, 255); }
-    SDL_FRect playerRenderRect = { player.rect.x - g_cameraX, player.rect.y, player.rect.w, player.rect.h }; SDL_RenderTexture(g_renderer, g_player, nullptr, &playerRenderRect);
-    if(g_playerIsFlashing) SDL_SetTextureAlphaMod(g_player, 255);
-    if (g_levelUpTextStartTime > 0 && g_levelUpTextTexture) { Uint32 elapsed = SDL_GetTicks() - g_levelUpTextStartTime; if (elapsed < LEVEL_UP_TEXT_DURATION) { float alphaPercent = 1.0f - ((float)elapsed / (float)LEVEL_UP_TEXT_DURATION); Uint8 alpha = (Uint8)(alphaPercent * 255.0f); SDL_SetTextureAlphaMod(g_levelUpTextTexture, alpha); SDL_FRect renderRect = g_levelUpTextRect; renderRect.x -= g_cameraX; SDL_RenderTexture(g_renderer, g_levelUpTextTexture, nullptr, &renderRect); SDL_SetTextureAlphaMod(g_levelUpTextTexture, 255); } else { g_levelUpTextStartTime = 0; } }
+inline float lerp(float a, float b, float t) { return a + (b - a) * t; }
+void drawGameWorld(const RenderSnapshot& snap, float alpha = 1.0f) {
+    const float camX = lerp(snap.prevCameraX, snap.cameraX, alpha);
+    {
+        ProfScope worldScope(PROF_DRAW_WORLD);
+        SDL_SetRenderDrawColor(g_renderer, 135, 206, 250, 255); SDL_RenderClear(g_renderer);
+        if(g_backgroundTexture&&g_bgWidth>0&&g_bgHeight>0){ float p=0.5f,s=(float)SCREEN_HEIGHT/g_bgHeight,sw=g_bgWidth*s,o=fmod(camX*p,sw); SDL_FRect r1={-o,0,sw,(float)SCREEN_HEIGHT},r2={-o+sw,0,sw,(float)SCREEN_HEIGHT}; SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r1); SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r2); g_prof.drawCalls+=2; }
+        const float viewX0 = camX, viewX1 = camX + SCREEN_WIDTH; const float bobPhase = (float)SDL_GetTicks() / 350.0f;
+        for (const SnapshotSprite& sp : snap.sprites) {
+            SDL_FRect r = sp.rect; r.x = lerp(sp.prevX, r.x, alpha);
+            if (r.x + r.w < viewX0 || r.x > viewX1) continue;
+            if (sp.flags & SNAPSHOT_BOB) r.y += sinf(bobPhase + sp.rect.x) * 5.0f;
+            r.x -= camX; pushSprite(sp.sprite, r);
+        }
+        Uint8 playerAlpha = 255;
+        if (g_playerIsFlashing) { Uint32 elapsed = SDL_GetTicks() - g_flashStartTime; if (elapsed >= FLASH_DURATION) { g_playerIsFlashing = false; } else if ((elapsed / FLASH_INTERVAL) % 2 == 0) { playerAlpha = 100; } }
+        SDL_FRect playerRenderRect = { lerp(snap.playerPrev.x, snap.player.x, alpha) - camX, lerp(snap.playerPrev.y, snap.player.y, alpha), snap.player.w, snap.player.h }; pushSprite(SPRITE_PLAYER, playerRenderRect, playerAlpha);
+        // HUD hearts ride in the same batch as the world
+        float heartSize = 30.0f, heartSpacing = 35.0f, currentHeartX = 250.0f; for (int i = 0; i < 5; i++) { SDL_FRect heartRect = { currentHeartX, 30.0f, heartSize, heartSize }; int hpThreshold = (i + 1) * 20; pushSprite(snap.hp >= hpThreshold ? SPRITE_HEART_FULL : SPRITE_HEART_EMPTY, heartRect); currentHeartX += heartSpacing; }
+        flushSprites();
+        drawParticles(camX);
+    }
+    ProfScope hudScope(PROF_DRAW_HUD);
+    drawPopups(camX);
     // HUD
-    SDL_Color tc={255,255,255,255}; SDL_Surface*s=nullptr; SDL_Texture*t=nullptr; SDL_FRect tr; float c1=50,c2=250,c3=450,c4=650; float hudYPos = 20.0f; float heartSize = 30.0f; float heartSpacing = 35.0f;
-    if (g_heartFullTexture && g_heartEmptyTexture) { float currentHeartX = c2; for (int i = 0; i < 5; i++) { SDL_FRect heartRect = { currentHeartX, hudYPos + 10, heartSize, heartSize }; int hpThreshold = (i + 1) * 20; if (player.hp >= hpThreshold) SDL_RenderTexture(g_renderer, g_heartFullTexture, nullptr, &heartRect); else SDL_RenderTexture(g_renderer, g_heartEmptyTexture, nullptr, &heartRect); currentHeartX += heartSpacing; } }
-    s=TTF_RenderText_Blended(g_smallFont,"UET",0,tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={c1,20,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} std::string it=std::to_string(g_totalItemCount);s=TTF_RenderText_Blended(g_smallFont,it.c_str(),it.length(),tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={c1,50,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);}
-    std::string levelName=(g_level>=1 && static_cast<size_t>(g_level)<LEVEL_NAMES.size()) ? LEVEL_NAMES[g_level] : "LEVEL"; s=TTF_RenderText_Blended(g_smallFont,levelName.c_str(),levelName.length(),tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={c3+(150-s->w)/2.0f,35,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);}
-    s=TTF_RenderText_Blended(g_smallFont,"TIME",0,tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={c4,20,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} std::string tt=std::to_string(g_playTimeSeconds); s=TTF_RenderText_Blended(g_smallFont,tt.c_str(),tt.length(),tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={c4,50,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);}
+    SDL_Color tc={255,255,255,255}; float c1=50,c3=450,c4=650;
+    drawText(g_smallFont,"UET",tc,c1,20); drawNumber(g_smallFont,(Uint32)snap.totalItemCount,tc,c1,50);
+    static const std::string fallbackLevelName="LEVEL"; const std::string& levelName=(snap.level>=1 && static_cast<size_t>(snap.level)<LEVEL_NAMES.size()) ? LEVEL_NAMES[snap.level] : fallbackLevelName; drawTextCentered(g_smallFont,levelName,tc,c3+75,35);
+    drawText(g_smallFont,"TIME",tc,c4,20); drawNumber(g_smallFont,g_playTimeSeconds,tc,c4,50);
+}
+
+// Frozen Frame: PAUSE, FINISH and GAME_OVER show a world that no longer moves, so the last world frame and
+// the scene's static overlay are drawn once into a render target and every later frame is a single copy of it.
+// Invalidated by gameplay, a reset or a render-target reset; without target support the scene draws live
+SDL_Texture* g_frozenFrame = nullptr; Scene g_frozenScene = Scene::MENU; bool g_frozenValid = false;
+void invalidateFrozenFrame() { g_frozenValid = false; }
+void drawFrozenFrame(Scene scene, void (*drawOverlay)()) {
+    if (!g_frozenValid || g_frozenScene != scene) {
+        if (!g_frozenFrame) {
+            g_frozenFrame = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+            if (g_frozenFrame) { SDL_SetTextureBlendMode(g_frozenFrame, SDL_BLENDMODE_NONE); g_prof.texturesCreated++; }
+        }
+        const bool captured = g_frozenFrame && SDL_SetRenderTarget(g_renderer, g_frozenFrame);
+        drawGameWorld(g_snapshots.read());
+        { ProfScope ps(PROF_DRAW_SCENE); drawOverlay(); }
+        if (!captured) return;
+        SDL_SetRenderTarget(g_renderer, nullptr);
+        g_frozenScene = scene; g_frozenValid = true;
+    }
+    ProfScope ps(PROF_DRAW_SCENE);
+    SDL_RenderTexture(g_renderer, g_frozenFrame, nullptr, nullptr); g_prof.drawCalls++;
+}
+
+// Profiler overlay (F3) and export
+double profMs(Uint64 ticks) { return (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency(); }
+void drawProfilerOverlay() {
+    const int n = (int)std::min<Uint32>(g_profFrames, PROF_HISTORY); if (n == 0) return;
+    double frameMs[PROF_HISTORY], phaseMs[PROF_COUNT] = {};
+    for (int i = 0; i < n; i++) { frameMs[i] = profMs(g_profHistory[i].ticks); for (int p = 0; p < PROF_COUNT; p++) phaseMs[p] += profMs(g_profHistory[i].phaseTicks[p]) / n; }
+    std::sort(frameMs, frameMs + n);
+    const FrameProfile& last = g_profHistory[(g_profFrames - 1) % PROF_HISTORY];
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE; SDL_GetRenderDrawBlendMode(g_renderer, &blend);
+    SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND); SDL_SetRenderDrawColor(g_renderer, 0, 0, 0, 180);
+    SDL_FRect bg = {SCREEN_WIDTH - 250.0f, SCREEN_HEIGHT - 20.0f - 12.0f * (PROF_COUNT + 3), 245.0f, 12.0f * (PROF_COUNT + 3) + 15.0f}; SDL_RenderFillRect(g_renderer, &bg);
+    SDL_SetRenderDrawColor(g_renderer, 255, 255, 255, 255);
+    char line[64]; float x = bg.x + 5.0f, y = bg.y + 5.0f;
+    snprintf(line, sizeof(line), "frame p50 %.2f p99 %.2f ms", frameMs[n / 2], frameMs[std::min(n - 1, n * 99 / 100)]); SDL_RenderDebugText(g_renderer, x, y, line); y += 12.0f;
+    snprintf(line, sizeof(line), "max %.2f ms over %d frames", frameMs[n - 1], n); SDL_RenderDebugText(g_renderer, x, y, line); y += 12.0f;
+    for (int p = 0; p < PROF_COUNT; p++) { snprintf(line, sizeof(line), "%-11s %6.3f ms", PROF_PHASE_NAMES[p], phaseMs[p]); SDL_RenderDebugText(g_renderer, x, y, line); y += 12.0f; }
+    snprintf(line, sizeof(line), "draws %u tex+ %u tests %u fx %u", last.drawCalls, last.texturesCreated, last.entitiesTested, last.particles); SDL_RenderDebugText(g_renderer, x, y, line);
+    SDL_SetRenderDrawBlendMode(g_renderer, blend);
+}
+// Writes the logged frames as CSV when the path ends in .csv, otherwise as Chrome-trace JSON (chrome://tracing, Perfetto)
+void exportProfile() {
+    if (!g_profLogging || g_profLog.empty()) return;
+    std::ofstream out(g_profPath);
+    if (!out) { std::cout << "Warning: Failed to write profile " << g_profPath << "\n"; return; }
+    // Oldest first; frame numbers count from the start of the session, so a wrapped log starts past 0
+    const Uint64 firstFrame = g_profLogged - g_profLog.size(), firstEvent = g_profTraced - g_profTrace.size();
+    auto frameAt = [](Uint64 f) -> const FrameProfile& { return g_profLog[f % PROF_LOG_FRAMES]; };
+    const Uint64 origin = frameAt(firstFrame).start;
+    auto us = [origin](Uint64 t) { return profMs(t - origin) * 1000.0; };
+    if (g_profPath.size() >= 4 && g_profPath.compare(g_profPath.size() - 4, 4, ".csv") == 0) {
+        out << "frame,frame_ms"; for (const char* name : PROF_PHASE_NAMES) out << "," << name << "_ms"; out << ",sim_steps,draw_calls,textures_created,entities_tested\n";
+        for (Uint64 f = firstFrame; f < g_profLogged; f++) {
+            const FrameProfile& fp = frameAt(f); out << f << "," << profMs(fp.ticks);
+            for (Uint64 t : fp.phaseTicks) out << "," << profMs(t);
+            out << "," << fp.simSteps << "," << fp.drawCalls << "," << fp.texturesCreated << "," << fp.entitiesTested << "\n";
+        }
+    } else {
+        out << "{\"traceEvents\":[\n";
+        for (Uint64 f = firstFrame; f < g_profLogged; f++) {
+            const FrameProfile& fp = frameAt(f);
+            out << (f > firstFrame ? ",\n" : "") << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << us(fp.start) << ",\"dur\":" << profMs(fp.ticks) * 1000.0 << ",\"args\":{\"frame\":" << f << "}},\n";
+            out << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << us(fp.start) << ",\"args\":{\"draw_calls\":" << fp.drawCalls << ",\"textures_created\":" << fp.texturesCreated << ",\"entities_tested\":" << fp.entitiesTested << "}}";
+        }
+        for (Uint64 i = firstEvent; i < g_profTraced; i++) {
+            const TraceEvent& ev = g_profTrace[i % PROF_LOG_EVENTS];
+            if (ev.start < origin) continue; // older than the first frame kept
+            out << ",\n{\"name\":\"" << PROF_PHASE_NAMES[ev.phase] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (int)ev.thread << ",\"ts\":" << us(ev.start) << ",\"dur\":" << profMs(ev.ticks) * 1000.0 << "}";
+        }
+        out << "\n]}\n";
+    }
+    std::cout << "Profile: " << g_profLog.size() << " frames, " << g_profTrace.size() << " events written to " << g_profPath;
+    if (firstFrame > 0) std::cout << " (newest only, " << firstFrame << " older frames dropped)";
+    std::cout << "\n";
+}
+
+// Input Recording: a session's seed plus its per-tick inputs, run-length encoded. File layout
+// (little endian): "UETR", u32 version, u64 seed, u8 endless, u32 items per level, f32 speed ramp,
+// f32 damage ramp, u32 ticks, u32 runs, runs x {u8 input bits, u16 length}, u64 hash of the final state
+enum InputBits : Uint8 { INPUT_LEFT = 1, INPUT_RIGHT = 2, INPUT_JUMP_HELD = 4, INPUT_JUMP_PRESSED = 8 };
+struct InputRun { Uint8 bits; Uint16 length; };
+struct InputRecording { Uint64 seed = 0; bool endless = false; Difficulty difficulty; Uint32 ticks = 0; std::vector<InputRun> runs; Uint64 finalHash = 0; };
+const Uint32 RECORDING_VERSION = 4; // bumped whenever the format, simulation or final hash changes: 2 = swept collision, 3 = hash the outcome, not the scene, 4 = difficulty
+Difficulty g_difficulty; // from the command line; a replay runs with the recording's own
+InputRecording g_recording; std::string g_recordPath, g_recordingFile; int g_recordedSessions = 0; bool g_recordingOpen = false;
+InputRecording g_replay; std::atomic<bool> g_replayActive{false}; size_t g_replayRun = 0; Uint32 g_replayRunTick = 0, g_replayTick = 0; Uint64 g_replayStartCounter = 0; // the sim thread ends a replay while the main thread polls g_replayActive
+
+Uint64 sessionStateHash() {
+    Uint64 h = 1469598103934665603ULL;
+    auto mix = [&h](Uint32 v) { for (int i = 0; i < 4; i++) { h ^= (v >> (i * 8)) & 0xFF; h *= 1099511628211ULL; } };
+    auto mixFloat = [&mix](float f) { Uint32 v; memcpy(&v, &f, sizeof(v)); mix(v); };
+    mixFloat(g_world.player.rect.x); mixFloat(g_world.player.rect.y); mixFloat(g_world.player.velocityX); mixFloat(g_world.player.velocityY);
+    mix((Uint32)g_world.player.hp); mix((Uint32)g_world.score); mix((Uint32)g_world.totalItemCount); mix((Uint32)g_world.level); mix((Uint32)g_world.outcome);
+    return h;
+}
+void writeLE(std::ostream& out, Uint64 v, int bytes) { for (int i = 0; i < bytes; i++) out.put((char)((v >> (i * 8)) & 0xFF)); }
+Uint64 readLE(std::istream& in, int bytes) { Uint64 v = 0; for (int i = 0; i < bytes; i++) v |= (Uint64)(Uint8)in.get() << (i * 8); return v; }
+bool saveRecording(const std::string& path, const InputRecording& rec) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) { std::cout << "Warning: Failed to write recording " << path << "\n"; return false; }
+    out.write("UETR", 4); writeLE(out, RECORDING_VERSION, 4); writeLE(out, rec.seed, 8); writeLE(out, rec.endless ? 1 : 0, 1);
+    Uint32 speedRamp, damageRamp; memcpy(&speedRamp, &rec.difficulty.speedRamp, 4); memcpy(&damageRamp, &rec.difficulty.damageSpeedRamp, 4);
+    writeLE(out, (Uint32)rec.difficulty.itemsPerLevel, 4); writeLE(out, speedRamp, 4); writeLE(out, damageRamp, 4);
+    writeLE(out, rec.ticks, 4); writeLE(out, rec.runs.size(), 4);
+    for (const InputRun& run : rec.runs) { writeLE(out, run.bits, 1); writeLE(out, run.length, 2); }
+    writeLE(out, rec.finalHash, 8);
+    return (bool)out;
+}
+bool loadRecording(const std::string& path, InputRecording& rec) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4] = {}; if (!in || !in.read(magic, 4) || memcmp(magic, "UETR", 4) != 0) { std::cout << "Failed to read recording " << path << "\n"; return false; }
+    if (readLE(in, 4) != RECORDING_VERSION) { std::cout << "Unsupported recording version in " << path << "\n"; return false; }
+    rec.seed = readLE(in, 8); rec.endless = readLE(in, 1) != 0;
+    rec.difficulty.itemsPerLevel = (int)readLE(in, 4);
+    Uint32 speedRamp = (Uint32)readLE(in, 4), damageRamp = (Uint32)readLE(in, 4); memcpy(&rec.difficulty.speedRamp, &speedRamp, 4); memcpy(&rec.difficulty.damageSpeedRamp, &damageRamp, 4);
+    rec.ticks = (Uint32)readLE(in, 4);
+    Uint32 runCount = (Uint32)readLE(in, 4); rec.runs.clear();
+    Uint64 total = 0;
+    for (Uint32 i = 0; i < runCount && in; i++) { InputRun run; run.bits = (Uint8)readLE(in, 1); run.length = (Uint16)readLE(in, 2); total += run.length; rec.runs.push_back(run); }
+    rec.finalHash = readLE(in, 8);
+    if (!in || total != rec.ticks) { std::cout << "Truncated recording " << path << "\n"; return false; }
+    return true;
+}
+// The first session records to --record FILE as given; later ones in the same process to FILE-2, FILE-3, ...
+// (the index goes before the extension) so every run is kept
+std::string recordingPathFor(int session) {
+    if (session <= 1) return g_recordPath;
+    const size_t slash = g_recordPath.find_last_of("/\\"), dot = g_recordPath.find_last_of('.');
+    const size_t at = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? dot : g_recordPath.size();
+    return g_recordPath.substr(0, at) + "-" + std::to_string(session) + g_recordPath.substr(at);
+}
+void startRecording(Uint64 seed) {
+    if (g_recordPath.empty() || g_replayActive) return;
+    g_recordingFile = recordingPathFor(++g_recordedSessions);
+    g_recording = InputRecording(); g_recording.seed = seed; g_recording.endless = g_endlessMode; g_recording.difficulty = g_world.difficulty; g_recordingOpen = true;
+}
+// Writes the open recording; called when a session ends, a new one starts or the game quits
+void finishRecording() {
+    if (!g_recordingOpen) return;
+    g_recordingOpen = false; g_recording.finalHash = sessionStateHash();
+    if (saveRecording(g_recordingFile, g_recording)) std::cout << "Recorded " << g_recording.ticks << " ticks (" << g_recording.runs.size() << " runs) to " << g_recordingFile << "\n";
+}
+void recordTick(Uint8 bits) {
+    if (!g_recordingOpen) return;
+    if (!g_recording.runs.empty() && g_recording.runs.back().bits == bits && g_recording.runs.back().length < 0xFFFF) g_recording.runs.back().length++;
+    else g_recording.runs.push_back({bits, 1});
+    g_recording.ticks++;
+}
+void startReplay() { g_replayActive = true; g_replayRun = 0; g_replayRunTick = 0; g_replayTick = 0; g_endlessMode = g_replay.endless; g_replayStartCounter = SDL_GetPerformanceCounter(); }
+void endReplay() {
+    g_replayActive = false;
+    double sec = (double)(SDL_GetPerformanceCounter() - g_replayStartCounter) / (double)SDL_GetPerformanceFrequency();
+    const char* verdict = g_replayTick < g_replay.ticks && g_world.outcome == WORLD_RUNNING ? "left by the player" : sessionStateHash() == g_replay.finalHash ? "state matches recording" : "DIVERGED from recording";
+    std::cout << "replay: " << g_replayTick << "/" << g_replay.ticks << " ticks in " << sec << " s, " << verdict << "\n";
+}
+bool nextReplayInput(Uint8& bits) {
+    while (g_replayRun < g_replay.runs.size() && g_replayRunTick >= g_replay.runs[g_replayRun].length) { g_replayRun++; g_replayRunTick = 0; }
+    if (g_replayRun >= g_replay.runs.size()) return false;
+    bits = g_replay.runs[g_replayRun].bits; g_replayRunTick++; g_replayTick++;
+    return true;
+}
+Uint8 packInput(bool isMovingLeft, bool isMovingRight, bool isJumpHeld) {
+    return (Uint8)((isMovingLeft ? INPUT_LEFT : 0) | (isMovingRight ? INPUT_RIGHT : 0) | (isJumpHeld ? INPUT_JUMP_HELD : 0) | (g_world.player.jumpInputPressed ? INPUT_JUMP_PRESSED : 0));
+}
+
+// One simulation tick from packed inputs; a replay substitutes its own. Returns false once the session has
+// stopped: the run ended or the replay ran out. The caller then applies the scene change on the main thread
+bool simTick(Uint8 bits) {
+    if (g_replayActive && !nextReplayInput(bits)) { endReplay(); return false; }
+    recordTick(bits);
+    g_world.player.jumpInputPressed = (bits & INPUT_JUMP_PRESSED) != 0;
+    worldStep(g_world, SIM_DT, (bits & INPUT_LEFT) != 0, (bits & INPUT_RIGHT) != 0, (bits & INPUT_JUMP_HELD) != 0);
+    const bool running = g_world.outcome == WORLD_RUNNING;
+    if (!running) finishRecording();
+    if (g_replayActive && (!running || g_replayTick == g_replay.ticks)) { endReplay(); return false; }
+    return running;
+}
+// Results for a finished run; a replay that ran out hands control back to the player paused
+void applySessionEnd() {
+    if (g_world.outcome == WORLD_RUNNING) { g_currentScene = Scene::PAUSE; return; }
+    if(g_gameInProgress) { addHighScore(g_world.totalItemCount); g_gameInProgress = false; }
+    g_currentScene = g_world.outcome == WORLD_FINISHED ? Scene::FINISH : Scene::GAME_OVER;
+}
+
+// Simulation Thread: while a run is playing, ticks run on their own thread at SIM_DT_NS, paced by the clock
+// rather than by frames, and each batch publishes a snapshot. The main thread only feeds it timestamped input
+// and parks it (simPause) before touching g_world: to pause, reset or end a session. Fast replays run
+// lock-step on the main thread instead, one tick per frame, until the replay ends
+struct InputEvent { Uint64 timeNS; Uint8 held; bool jumpPressed; };
+struct SimThread {
+    std::thread thread; bool lockstep = false;
+    std::mutex mutex; std::condition_variable wake, parkedCv;
+    bool quit = false, parked = true;             // guarded by mutex
+    std::atomic<bool> run{false}, stopped{false}; // stopped: the session ended on the sim thread, awaiting applySessionEnd
+    Uint64 nextTickNS = 0;
+    std::mutex inputMutex; std::vector<InputEvent> inputQueue; // main thread -> sim thread, in timestamp order
+    Uint8 held = 0; bool jumpLatch = false;                    // sim side: input as of the last consumed event
+};
+SimThread g_sim;
+Uint8 g_inputHeld = 0; // main thread: held bits as the key events have left them
+
+void pushInput(Uint64 timeNS, bool jumpPressed) {
+    std::lock_guard<std::mutex> lock(g_sim.inputMutex);
+    g_sim.inputQueue.push_back({timeNS, g_inputHeld, jumpPressed});
+}
+// Input for the tick due at tickNS: applies every event stamped up to then. A press shorter than a tick still jumps
+Uint8 simInputFor(Uint64 tickNS) {
+    {
+        std::lock_guard<std::mutex> lock(g_sim.inputMutex);
+        size_t n = 0;
+        for (; n < g_sim.inputQueue.size() && g_sim.inputQueue[n].timeNS <= tickNS; n++) { g_sim.held = g_sim.inputQueue[n].held; g_sim.jumpLatch = g_sim.jumpLatch || g_sim.inputQueue[n].jumpPressed; }
+        g_sim.inputQueue.erase(g_sim.inputQueue.begin(), g_sim.inputQueue.begin() + n);
+    }
+    const Uint8 bits = (Uint8)(g_sim.held | (g_sim.jumpLatch ? INPUT_JUMP_PRESSED : 0));
+    g_sim.jumpLatch = false;
+    return bits;
+}
+// Runs the ticks due by nowNS and publishes the result. Returns false once the session has stopped
+bool simAdvance(Uint64 nowNS) {
+    int steps = 0; bool running = true;
+    while (running && g_sim.nextTickNS <= nowNS && steps < MAX_SIM_STEPS_PER_FRAME) {
+        running = simTick(simInputFor(g_sim.nextTickNS));
+        for (const WorldEvent& ev : g_world.eventLog) g_eventRing[g_eventCount++ % SNAPSHOT_EVENT_RING] = ev;
+        g_sim.nextTickNS += SIM_DT_NS; steps++;
+    }
+    if (running && g_sim.nextTickNS <= nowNS) g_sim.nextTickNS = nowNS + SIM_DT_NS; // drop the backlog after a long hitch
+    g_prof.simSteps += steps;
+    if (steps > 0) publishSnapshot(g_world, g_sim.nextTickNS - SIM_DT_NS);
+    return running;
+}
+void simThreadMain() {
+    g_profThread = 2;
+    std::unique_lock<std::mutex> lock(g_sim.mutex);
+    for (;;) {
+        g_sim.parked = true; g_sim.parkedCv.notify_all();
+        g_sim.wake.wait(lock, []() { return g_sim.quit || g_sim.run.load(); });
+        if (g_sim.quit) return;
+        g_sim.parked = false;
+        lock.unlock();
+        while (g_sim.run.load(std::memory_order_acquire)) {
+            const Uint64 now = SDL_GetTicksNS();
+            if (now < g_sim.nextTickNS) { SDL_DelayNS(g_sim.nextTickNS - now); continue; }
+            const bool running = simAdvance(now); // publishes the final snapshot before stopped is raised
+            profFlushSimThread();
+            if (!running) {
+                g_sim.stopped.store(true, std::memory_order_release); // before run drops, so simResume never sees both clear
+                g_sim.run.store(false);
+            }
+        }
+        lock.lock();
+    }
+}
+void startSimThread(bool lockstep) { g_sim.lockstep = lockstep; if (!lockstep) g_sim.thread = std::thread(simThreadMain); }
+void stopSimThread() {
+    if (!g_sim.thread.joinable()) return;
+    { std::lock_guard<std::mutex> lock(g_sim.mutex); g_sim.quit = true; g_sim.run = false; }
+    g_sim.wake.notify_all(); g_sim.thread.join();
+}
+// Returns once the sim thread is parked; g_world then belongs to the caller
+void simPause() {
+    if (!g_sim.thread.joinable()) return;
+    std::unique_lock<std::mutex> lock(g_sim.mutex);
+    g_sim.run = false; g_sim.parkedCv.wait(lock, []() { return g_sim.parked; });
+}
+void simResume() {
+    if (g_sim.stopped.load(std::memory_order_acquire) || g_sim.run.load()) return;
+    // A thread that has just cleared run may still be finishing its last batch; nextTickNS and the input
+    // latch are only touched once it has parked
+    std::unique_lock<std::mutex> lock(g_sim.mutex);
+    g_sim.parkedCv.wait(lock, []() { return g_sim.parked; });
+    if (g_sim.stopped.load(std::memory_order_acquire)) return;
+    { std::lock_guard<std::mutex> inputLock(g_sim.inputMutex); g_sim.inputQueue.clear(); g_sim.held = g_inputHeld; g_sim.jumpLatch = false; }
+    if (!g_sim.thread.joinable()) return;
+    g_sim.nextTickNS = SDL_GetTicksNS() + SIM_DT_NS; g_sim.run = true;
+    lock.unlock(); g_sim.wake.notify_all();
+}
+// Applies a run that ended on the sim thread, whatever scene the player has moved to since (an ESC in the same
+// frame must not lose the result), then shows the final snapshot
+void simApplyStop() {
+    if (!g_sim.stopped.load(std::memory_order_acquire)) return;
+    simPause(); g_sim.stopped = false;
+    acquireSnapshot(); invalidateFrozenFrame();
+    applySessionEnd();
 }
 
 // Scene Render Functions
-void renderScenePlay(float dt, bool isMovingLeft, bool isMovingRight, bool isJumpHeld) {
+void renderScenePlay(float frameDt) {
+    invalidateFrozenFrame();
+    if (g_sim.lockstep && !g_sim.stopped.load()) { g_sim.nextTickNS = SDL_GetTicksNS(); if (!simAdvance(g_sim.nextTickNS)) g_sim.stopped = true; }
+    simApplyStop();
+    acquireSnapshot();
     if (g_gameStartTime != 0) g_playTimeSeconds = (SDL_GetTicks() - g_gameStartTime) / 1000;
-    if (g_levelUpTextStartTime > 0) { Uint32 elapsed = SDL_GetTicks() - g_levelUpTextStartTime; if (elapsed < LEVEL_UP_TEXT_DURATION) g_levelUpTextRect.y += LEVEL_UP_TEXT_VELOCITY_Y * dt; }
-    updateDamageItems(dt);
-    updatePlayer(dt, isMovingLeft, isMovingRight, isJumpHeld);
-    drawGameWorld();
+    updateEffects(frameDt);
+    const RenderSnapshot& snap = g_snapshots.read();
+    const float alpha = g_currentScene != Scene::PLAY || g_sim.lockstep ? 1.0f : std::min(1.0f, (float)(SDL_GetTicksNS() - std::min(SDL_GetTicksNS(), snap.tickNS)) / (float)SIM_DT_NS);
+    drawGameWorld(snap, alpha);
+}
+void drawFinishOverlay() { SDL_Color tc={0,0,0,255}; const float cx=SCREEN_WIDTH/2.0f; drawTextCentered(g_font,"CHUC MUNG!",tc,cx,100); drawTextCentered(g_font,"Vat pham: "+std::to_string(g_snapshots.read().totalItemCount),tc,cx,200); drawTextCentered(g_smallFont,"Thoi gian: "+std::to_string(g_playTimeSeconds)+"s",tc,cx,300); drawTextCentered(g_smallFont,"Bam ESC de ve Menu",tc,cx,400); }
+void drawGameOverOverlay() { SDL_Color tc={255,255,255,255}; const float cx=SCREEN_WIDTH/2.0f; drawTextCentered(g_font,"GAME OVER",tc,cx,150); drawTextCentered(g_smallFont,"Vat pham: "+std::to_string(g_snapshots.read().totalItemCount),tc,cx,300); drawTextCentered(g_smallFont,"Bam ESC de ve Menu",tc,cx,400); }
+void drawPauseOverlay() { SDL_BlendMode blend = SDL_BLENDMODE_NONE; SDL_GetRenderDrawBlendMode(g_renderer, &blend); SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND); SDL_SetRenderDrawColor(g_renderer, 0, 0, 0, 150); SDL_FRect overlayRect = {0, 0, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT}; SDL_RenderFillRect(g_renderer, &overlayRect); SDL_SetRenderDrawBlendMode(g_renderer, blend); SDL_Color tc = {255, 255, 255, 255}; drawTextCentered(g_font, "TAM DUNG", tc, SCREEN_WIDTH / 2.0f, 150); }
+void renderSceneFinish() { drawFrozenFrame(Scene::FINISH, drawFinishOverlay); }
+void renderSceneGameOver() { drawFrozenFrame(Scene::GAME_OVER, drawGameOverOverlay); }
+void renderScenePause() { drawFrozenFrame(Scene::PAUSE, drawPauseOverlay); ProfScope ps(PROF_DRAW_SCENE); float mouseX, mouseY; SDL_GetMouseState(&mouseX, &mouseY); SDL_Color bc = {255, 105, 180, 200}, btn_tc = {80, 80, 80, 255}; bool hoverResume = checkCollision(mouseX, mouseY, g_pauseButtons[0].rect); renderRoundedButton(g_renderer, g_pauseButtons[0], g_font, g_buttonTexture, bc, btn_tc, hoverResume); bool hoverMenu = checkCollision(mouseX, mouseY, g_pauseButtons[1].rect); renderRoundedButton(g_renderer, g_pauseButtons[1], g_font, g_buttonTexture, bc, btn_tc, hoverMenu); }
+void renderSceneScore() { ProfScope ps(PROF_DRAW_SCENE); SDL_SetRenderDrawColor(g_renderer, 30, 30, 70, 255); SDL_RenderClear(g_renderer); SDL_Color tc1={255,215,0,255}, tc2={255,255,255,255}, tc3={180,180,180,255}; const float cx=SCREEN_WIDTH/2.0f; drawTextCentered(g_font,"HIGH SCORES",tc1,cx,50); float y=150.0f; int r=1; if(g_highScores.empty()){drawTextCentered(g_smallFont,"No scores yet. Go play!",tc3,cx,y);}else{for(int sc:g_highScores){drawText(g_smallFont,std::to_string(r)+".   "+std::to_string(sc),tc2,cx-100.0f,y);y+=35.0f;r++;if(r>10)break;}} drawTextCentered(g_smallFont,"Press ESC for Menu",tc3,cx,SCREEN_HEIGHT-60.0f); }
+void renderSceneMenu(Uint32 currentTime, float dt) { ProfScope ps(PROF_DRAW_SCENE); if(g_backgroundTexture&&g_bgWidth>0&&g_bgHeight>0){ float scrollSpeed=30.0f; if(dt>0.05f)dt=0.05f; g_menuBgOffsetX+=scrollSpeed*dt; float s=(float)SCREEN_HEIGHT/g_bgHeight,sw=g_bgWidth*s,o=fmod(g_menuBgOffsetX,sw);SDL_FRect r1={-o,0,sw,(float)SCREEN_HEIGHT},r2={-o+sw,0,sw,(float)SCREEN_HEIGHT};SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r1);SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r2);} else {SDL_SetRenderDrawColor(g_renderer,173,216,230,255);SDL_RenderClear(g_renderer);} if(g_logoTexture){if(g_alpha<255&&!g_shrinking){g_alpha=(Uint8)SDL_min(g_alpha+3,255);SDL_SetTextureAlphaMod(g_logoTexture,g_alpha);}else{g_shrinking=true;}if(g_shrinking){if(g_logoRect.w>100){g_logoRect.w*=0.98f;g_logoRect.h*=0.98f;g_logoRect.x=(SCREEN_WIDTH-g_logoRect.w)/2.0f;g_logoRect.y=50.0f;}else{g_logoRect.x=20.0f;g_logoRect.y=20.0f;g_logoRect.w=100.0f;g_logoRect.h=100.0f;}}SDL_RenderTexture(g_renderer,g_logoTexture,nullptr,&g_logoRect);} {float lw=100,lh=120;SDL_FRect lr={150.0f,SCREEN_HEIGHT-lh-50.0f,lw,lh};lr.y+=sinf((float)currentTime/500.0f)*5.0f;renderSprite(SPRITE_PLAYER,lr);} g_buttons[0].rect={350,200,180,80}; g_buttons[1].rect={350,300,180,80}; g_buttons[2].rect={350,400,180,80}; g_buttons[3].rect={350,500,180,80}; if(currentTime-g_startTime>2000){ float mouseX, mouseY; SDL_GetMouseState(&mouseX, &mouseY); SDL_Color bc={255,105,180,200}, tc={80,80,80,255}; bool hoverPlay = checkCollision(mouseX, mouseY, g_buttons[0].rect); renderRoundedButton(g_renderer, g_buttons[0], g_font, g_buttonTexture, bc, tc, hoverPlay); bool hoverResume = checkCollision(mouseX, mouseY, g_buttons[1].rect); if (g_gameInProgress) { SDL_Color resume_bc = {100, 200, 255, 220}; SDL_Color resume_tc = {255, 255, 255, 255}; if (!hoverResume) { Uint8 alpha = 128 + (Uint8)((sinf((float)currentTime / 200.0f) + 1.0f) * 64); SDL_SetTextureAlphaMod(g_buttonTexture, alpha); } renderRoundedButton(g_renderer, g_buttons[1], g_font, g_buttonTexture, resume_bc, resume_tc, hoverResume); SDL_SetTextureAlphaMod(g_buttonTexture, 255); } else { renderRoundedButton(g_renderer, g_buttons[1], g_font, g_buttonTexture, bc, tc, hoverResume); } bool hoverScore = checkCollision(mouseX, mouseY, g_buttons[2].rect); renderRoundedButton(g_renderer, g_buttons[2], g_font, g_buttonTexture, bc, tc, hoverScore); bool hoverEndless = checkCollision(mouseX, mouseY, g_buttons[3].rect); renderRoundedButton(g_renderer, g_buttons[3], g_font, g_buttonTexture, bc, tc, hoverEndless); } }
+
+// Reset Function: replayStart is set only right after startReplay; any other new run is the player's and ends a
+// replay still in progress instead of feeding the rest of the recording into a fresh world
+void resetPlayer(bool replayStart = false) {
+    const Scene scene = g_currentScene; simApplyStop(); g_currentScene = scene; // a run that ended just now still records its score
+    simPause(); invalidateFrozenFrame(); g_gameStartTime = SDL_GetTicks(); g_playTimeSeconds = 0;
+    if (g_replayActive && !replayStart) endReplay();
+    g_gameInProgress = true; g_playerIsFlashing = false; clearEffects();
+    finishRecording();
+    Uint64 seed = g_replayActive ? g_replay.seed : takeSessionSeed();
+    g_world.difficulty = g_replayActive ? g_replay.difficulty : g_difficulty;
+    worldReset(g_world, seed); startRecording(seed);
+    if (!takePreparedTrack(seed, g_endlessMode)) worldGenerate(g_world, seed, g_endlessMode);
+    g_eventCount = 0; g_eventsSeen = 0; g_sim.stopped = false;
+    publishSnapshot(g_world, SDL_GetTicksNS());
+}
+
+// Headless Simulation: scripted input drives the same update path as Scene::PLAY, with no window, renderer or fonts
+struct HeadlessOptions { bool headless = false; bool bench = false; bool endless = false; int frames = 20000; unsigned int seed = 0; bool hasSeed = false; std::string recordPath, replayPath, profilePath; bool fast = false; int batch = 0; int threads = 0; int fps = -1; Difficulty difficulty; };
+
+void scriptedInput(World& w, bool& isMovingLeft, bool& isMovingRight, bool& isJumpHeld) {
+    const Player& player = w.player;
+    isMovingLeft = false; isMovingRight = true;
+    const float front = player.rect.x + player.rect.w;
+    bool obstacleAhead = false, hazardAhead = false, hazardBelow = false;
+    const float lookAhead = 40.0f + player.velocityX * 0.3f;
+    for (TrackChunk* chunk : chunksNear(w.track, front, front + lookAhead)) { const EntityStore& e = chunk->entities; for (Uint32 i = e.begin(KIND_OBSTACLE); i < e.end(KIND_OBSTACLE); i++) obstacleAhead = obstacleAhead || (e.x[i] + e.w[i] > front && e.x[i] < front + lookAhead); }
+    for (TrackChunk* chunk : chunksNear(w.track, player.rect.x, front + 200.0f)) for (Uint32 i = chunk->entities.begin(KIND_DAMAGE_ITEM); i < chunk->entities.end(KIND_DAMAGE_ITEM); i++) {
+        const EntityStore& e = chunk->entities;
+        if ((e.flags[i] & ENTITY_COLLECTED) || e.x[i] + e.w[i] <= player.rect.x) continue;
+        float gap = e.x[i] - front;
+        if (gap < 15.0f + player.velocityX * 0.12f) hazardAhead = true;
+        if (!player.onGround && player.velocityY > 0 && gap < 60.0f) hazardBelow = true;
+    }
+    if ((obstacleAhead || hazardAhead) && player.onGround) w.player.jumpInputPressed = true;
+    else if (hazardBelow && player.canDoubleJump) w.player.jumpInputPressed = true;
+    isJumpHeld = obstacleAhead || hazardAhead || hazardBelow || player.velocityY < 0;
+}
+// Runs one scripted session to FINISH / GAME_OVER or maxFrames simulation ticks; returns ticks simulated
+int runScriptedSession(int maxFrames) {
+    g_currentScene = Scene::PLAY; resetPlayer();
+    int frame = 0;
+    for (; frame < maxFrames; frame++) {
+        profBeginFrame();
+        bool l, r, j; scriptedInput(g_world, l, r, j);
+        const bool live = simTick(packInput(l, r, j));
+        g_prof.simSteps = 1; profEndFrame();
+        if (!live) { applySessionEnd(); frame++; break; }
+    }
+    finishRecording();
+    return frame;
+}
+// Replays a recording with no window; ticks until the session ends or the input runs out
+int runReplaySession() {
+    startReplay(); g_currentScene = Scene::PLAY; resetPlayer(true);
+    while (g_replayActive) {
+        profBeginFrame(); const bool live = simTick(0); g_prof.simSteps = 1; profEndFrame();
+        if (!live) { applySessionEnd(); break; }
+    }
+    return (int)g_replayTick;
+}
+int runHeadless(const HeadlessOptions& opt) {
+    seedSessions(opt.hasSeed ? opt.seed : (Uint64)time(NULL));
+    if (!opt.replayPath.empty() && !loadRecording(opt.replayPath, g_replay)) return 1;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    int frames = opt.replayPath.empty() ? runScriptedSession(opt.frames) : runReplaySession();
+    double sec = (double)(SDL_GetPerformanceCounter() - t0) / (double)SDL_GetPerformanceFrequency();
+    const char* outcome = g_currentScene == Scene::FINISH ? "finish" : g_currentScene == Scene::GAME_OVER ? "game over" : opt.replayPath.empty() ? "timeout" : "end of input";
+    std::cout << "headless: " << outcome << " after " << frames << " ticks, x=" << g_world.player.rect.x << ", hp=" << g_world.player.hp << ", items=" << g_world.totalItemCount << ", score=" << g_world.score << ", level=" << g_world.level << "\n";
+    std::cout << "headless: " << (frames > 0 ? sec * 1e9 / frames : 0.0) << " ns/tick at " << (int)(1.0f / SIM_DT + 0.5f) << " Hz\n";
+    return 0;
+}
+
+double benchSeconds(Uint64 start) { return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency(); }
+
+// Batch Simulation: many bot-driven Worlds at once for difficulty tuning. Session i gets the seed the i-th
+// interactive session would, so any run can be reproduced with --headless. Jobs are dealt round-robin into
+// per-thread deques; a thread pops its own front and steals from the back of others once it runs dry
+struct BatchResult { WorldOutcome outcome = WORLD_RUNNING; DeathCause deathCause = DEATH_NONE; int stuckVariant = -1; Uint32 ticks = 0; int items = 0; int level = 1; };
+struct BatchQueue { std::mutex mutex; std::deque<int> jobs; };
+const Uint32 BATCH_STUCK_TICKS = 120; // a timed-out run blocked this recently counts as stuck on that obstacle
+
+bool popBatchJob(std::vector<BatchQueue>& queues, size_t self, int& job) {
+    { std::lock_guard<std::mutex> lock(queues[self].mutex); if (!queues[self].jobs.empty()) { job = queues[self].jobs.front(); queues[self].jobs.pop_front(); return true; } }
+    for (size_t k = 1; k < queues.size(); k++) {
+        BatchQueue& q = queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.jobs.empty()) { job = q.jobs.back(); q.jobs.pop_back(); return true; }
+    }
+    return false;
+}
+BatchResult runBatchSession(World& w, Uint64 seed, const HeadlessOptions& opt) {
+    w.difficulty = opt.difficulty; worldReset(w, seed); worldGenerate(w, seed, opt.endless);
+    while (w.outcome == WORLD_RUNNING && w.ticks < (Uint32)opt.frames) { bool l, r, j; scriptedInput(w, l, r, j); worldStep(w, SIM_DT, l, r, j); }
+    BatchResult res; res.outcome = w.outcome; res.deathCause = w.deathCause; res.ticks = w.ticks; res.items = w.totalItemCount; res.level = w.level;
+    if (w.outcome == WORLD_RUNNING && w.blockedVariant >= 0 && w.ticks - w.blockedTick <= BATCH_STUCK_TICKS) res.stuckVariant = w.blockedVariant;
+    return res;
+}
+int runBatch(const HeadlessOptions& opt) {
+    const int count = opt.batch;
+    size_t threads = opt.threads > 0 ? (size_t)opt.threads : (size_t)std::max(1, SDL_GetNumLogicalCPUCores());
+    threads = std::min(threads, (size_t)count);
+    seedSessions(opt.hasSeed ? opt.seed : (Uint64)time(NULL));
+    std::vector<Uint64> seeds(count); for (Uint64& seed : seeds) seed = takeSessionSeed();
+    std::vector<BatchQueue> queues(threads);
+    for (int i = 0; i < count; i++) queues[i % threads].jobs.push_back(i);
+    std::vector<BatchResult> results(count);
+    std::vector<int> jobsRun(threads, 0);
+
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) workers.emplace_back([&, t]() {
+        World w; int job;
+        while (popBatchJob(queues, t, job)) { results[job] = runBatchSession(w, seeds[job], opt); jobsRun[t]++; }
+    });
+    for (std::thread& worker : workers) worker.join();
+    double sec = benchSeconds(t0);
+
+    int finished = 0, died = 0, timedOut = 0; int deaths[DEATH_CAUSE_COUNT] = {}; int stuck[OBSTACLE_VARIANT_COUNT] = {};
+    Uint64 ticks = 0, items = 0, levels = 0;
+    for (const BatchResult& res : results) {
+        if (res.outcome == WORLD_FINISHED) finished++; else if (res.outcome == WORLD_DIED) { died++; deaths[res.deathCause]++; } else timedOut++;
+        if (res.stuckVariant >= 0) stuck[res.stuckVariant]++;
+        ticks += res.ticks; items += (Uint64)res.items; levels += (Uint64)res.level;
+    }
+    auto pct = [count](int n) { return 100.0 * n / count; };
+    std::cout << "batch: " << count << " sessions on " << threads << " threads, " << (opt.endless ? "endless" : "track") << ", up to " << opt.frames << " ticks each\n";
+    std::cout << "batch: difficulty items/level=" << opt.difficulty.itemsPerLevel << " speed ramp=" << opt.difficulty.speedRamp << " damage ramp=" << opt.difficulty.damageSpeedRamp << "\n";
+    std::cout << "  finished   " << finished << " (" << pct(finished) << "%)\n";
+    std::cout << "  died       " << died << " (" << pct(died) << "%)\n";
+    for (int c = DEATH_NONE + 1; c < DEATH_CAUSE_COUNT; c++) std::cout << "    " << DEATH_CAUSE_NAMES[c] << ": " << deaths[c] << "\n";
+    std::cout << "  timed out  " << timedOut << " (" << pct(timedOut) << "%)\n";
+    for (int v = 0; v < OBSTACLE_VARIANT_COUNT; v++) if (stuck[v]) std::cout << "    stuck at " << OBSTACLE_VARIANT_NAMES[v] << ": " << stuck[v] << "\n";
+    std::cout << "  average    " << (double)ticks / count << " ticks, " << (double)items / count << " items, level " << (double)levels / count << "\n";
+    std::cout << "  throughput " << count / sec << " sessions/s, " << ticks / sec / 1e6 << " M ticks/s (" << sec << " s)\n";
+    std::cout << "  jobs/thread";
+    for (int n : jobsRun) std::cout << " " << n;
+    std::cout << "\n";
+    return 0;
+}
+
+// Benchmarks: generation per track, simulation per frame and software-rendered draw per frame
+int runBenchmarks(const HeadlessOptions& opt) {
+    seedSessions(opt.hasSeed ? opt.seed : 1u);
+    const int tracks = 50;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    for (int i = 0; i < tracks; i++) resetPlayer();
+    double resetSec = benchSeconds(t0);
+    double preparedSec = 0.0;
+    for (int i = 0; i < tracks; i++) {
+        prepareNextTrack(); while (!g_preparedTracks.ready.load(std::memory_order_acquire)) std::this_thread::yield();
+        Uint64 p0 = SDL_GetPerformanceCounter(); resetPlayer(); preparedSec += benchSeconds(p0);
+    }
+    std::cout << "reset        " << resetSec * 1e6 / tracks << " us/run generated, " << preparedSec * 1e6 / tracks << " us/run prepared (" << g_world.track.generatedEntities << " entities up front)\n";
+    Uint64 entities = 0; t0 = SDL_GetPerformanceCounter();
+    for (int i = 0; i < tracks; i++) { trackReset(g_world.track, (Uint64)i + 1u, false); for (float x = 0.0f; x <= TRACK_LENGTH; x += SCREEN_WIDTH / 2.0f) trackStream(g_world.track, x); entities += g_world.track.generatedEntities; }
+    double genSec = benchSeconds(t0);
+    std::cout << "generate     " << genSec * 1e3 / tracks << " ms/track (" << tracks << " tracks, " << entities / tracks << " entities each)\n";
+
+    int simulated = 0, sessions = 0; double simSec = 0.0;
+    while (simulated < opt.frames) {
+        seedSessions((opt.hasSeed ? opt.seed : 1u) + (Uint64)sessions); g_currentScene = Scene::PLAY; resetPlayer();
+        int left = opt.frames - simulated, frame = 0;
+        Uint64 s0 = SDL_GetPerformanceCounter();
+        for (; frame < left && g_world.outcome == WORLD_RUNNING; frame++) { bool l, r, j; scriptedInput(g_world, l, r, j); worldStep(g_world, SIM_DT, l, r, j); }
+        simSec += benchSeconds(s0); simulated += frame; sessions++;
+    }
+    std::cout << "update       " << simSec * 1e9 / simulated << " ns/tick (" << simulated << " ticks, " << sessions << " sessions)\n";
+
+    // Kernels: the pre-SoA per-object layout against the SoA store, scalar and vectorised
+    struct LegacyItem { SDL_FRect rect; SDL_Color color; bool isCollected; float baseVelocityX, velocityX, startX, moveRange, prevX; };
+    const size_t kernelCount = 1u << 20; const int kernelPasses = 20;
+    std::vector<LegacyItem> legacy(kernelCount); EntityStore store; Rng krng(opt.hasSeed ? opt.seed : 1u, 7u);
+    for (size_t i = 0; i < kernelCount; i++) {
+        float x = (float)(i * 40u), y = GROUND_Y - 40.0f - krng.range(100), v = 100.0f + krng.range(50), range = 80.0f + krng.range(40);
+        store.add(KIND_DAMAGE_ITEM, x, y, 40, 40, v, range);
+        legacy[i] = {{x, y, 40, 40}, {255, 0, 0, 255}, false, v, v, x, range, x};
+    }
+    const float scale = SIM_DT; const SDL_FRect probe = {(float)(kernelCount * 20u), GROUND_Y - 100.0f, 4000.0f, 60.0f};
+    size_t hitCount = 0; std::vector<Uint32> hits;
+    t0 = SDL_GetPerformanceCounter();
+    for (int p = 0; p < kernelPasses; p++) for (auto& d : legacy) { d.prevX = d.rect.x; d.rect.x += d.velocityX * scale; if (d.velocityX > 0 && d.rect.x >= d.startX + d.moveRange) { d.rect.x = d.startX + d.moveRange; d.velocityX = -d.velocityX; } else if (d.velocityX < 0 && d.rect.x <= d.startX - d.moveRange) { d.rect.x = d.startX - d.moveRange; d.velocityX = -d.velocityX; } }
+    double legacyPatrol = benchSeconds(t0); t0 = SDL_GetPerformanceCounter();
+    for (int p = 0; p < kernelPasses; p++) patrolScalar(store, 0, kernelCount, scale);
+    double soaPatrol = benchSeconds(t0); t0 = SDL_GetPerformanceCounter();
+    for (int p = 0; p < kernelPasses; p++) patrolKernel(store, 0, kernelCount, scale);
+    double simdPatrol = benchSeconds(t0); t0 = SDL_GetPerformanceCounter();
+    for (int p = 0; p < kernelPasses; p++) for (size_t i = 0; i < kernelCount; i++) if (!legacy[i].isCollected && checkRectCollision(probe, legacy[i].rect)) hitCount++;
+    double legacyOverlap = benchSeconds(t0); t0 = SDL_GetPerformanceCounter();
+    for (int p = 0; p < kernelPasses; p++) { hits.clear(); overlapScalar(store, 0, kernelCount, probe, hits); hitCount += hits.size(); }
+    double soaOverlap = benchSeconds(t0); t0 = SDL_GetPerformanceCounter();
+    for (int p = 0; p < kernelPasses; p++) { hits.clear(); overlapKernel(store, 0, kernelCount, probe, hits); hitCount += hits.size(); }
+    double simdOverlap = benchSeconds(t0);
+    const double perEntity = 1e9 / ((double)kernelCount * kernelPasses);
+#if defined(__AVX__)
+    const char* simdName = "avx";
+#elif defined(UET_RUN_SSE2)
+    const char* simdName = "sse2";
+#else
+    const char* simdName = "scalar";
+#endif
+    std::cout << "patrol       " << legacyPatrol * perEntity << " / " << soaPatrol * perEntity << " / " << simdPatrol * perEntity << " ns/entity (aos / soa / " << simdName << ", " << kernelCount << " entities)\n";
+    std::cout << "overlap      " << legacyOverlap * perEntity << " / " << soaOverlap * perEntity << " / " << simdOverlap * perEntity << " ns/entity (aos / soa / " << simdName << ", " << hitCount / (3 * kernelPasses) << " hits)\n";
+
+    if (!TTF_Init()) { std::cout << "render       skipped: TTF_Init failed: " << SDL_GetError() << "\n"; return 0; }
+    SDL_Surface* target = SDL_CreateSurface(SCREEN_WIDTH, SCREEN_HEIGHT, SDL_PIXELFORMAT_RGBA32);
+    g_renderer = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+    if (!g_renderer) { std::cout << "render       skipped: no software renderer: " << SDL_GetError() << "\n"; if (target) SDL_DestroySurface(target); TTF_Quit(); return 0; }
+    // Asset load: decoding loose PNGs against creating textures from the mapped bundle (warm file cache)
+    auto releaseTextures = []() { for (SDL_Texture** t : IMAGE_TEXTURES) if (*t) { SDL_DestroyTexture(*t); *t = nullptr; } if (g_atlasTexture) { SDL_DestroyTexture(g_atlasTexture); g_atlasTexture = nullptr; } };
+    Uint64 a0 = SDL_GetPerformanceCounter();
+    for (int i = 0; i < IMAGE_COUNT; i++) *IMAGE_TEXTURES[i] = IMG_LoadTexture(g_renderer, IMAGE_PATHS[i]);
+    loadSpriteAtlas();
+    double looseSec = benchSeconds(a0);
+    releaseTextures(); a0 = SDL_GetPerformanceCounter();
+    const bool bundled = openAssetBundle() && loadBundleTextures();
+    double bundleSec = benchSeconds(a0);
+    if (bundled) std::cout << "assets       " << looseSec * 1e3 << " ms loose, " << bundleSec * 1e3 << " ms from " << BUNDLE_PATH << "\n";
+    else { std::cout << "assets       " << looseSec * 1e3 << " ms loose, no bundle (build the bundle target)\n"; for (int i = 0; i < IMAGE_COUNT; i++) *IMAGE_TEXTURES[i] = IMG_LoadTexture(g_renderer, IMAGE_PATHS[i]); loadSpriteAtlas(); }
+    if (g_backgroundTexture) SDL_GetTextureSize(g_backgroundTexture, &g_bgWidth, &g_bgHeight);
+    g_smallFont = openGameFont(24);
+    seedSessions(opt.hasSeed ? opt.seed : 1u); g_currentScene = Scene::PLAY; resetPlayer();
+    const int renderFrames = std::max(1, std::min(opt.frames, 2000));
+    Uint64 r0 = SDL_GetPerformanceCounter();
+    RenderSnapshot snap;
+    for (int i = 0; i < renderFrames; i++) { g_world.player.rect.x = 100.0f + i * 6.0f; g_world.cameraX = g_world.player.rect.x - 200.0f; if (g_world.cameraX < 0) g_world.cameraX = 0; captureSnapshot(g_world, 0, snap); drawGameWorld(snap); g_frameCounter++; }
+    double renderSec = benchSeconds(r0);
+    std::cout << "render       " << renderSec * 1e9 / renderFrames << " ns/frame (" << renderFrames << " frames, software renderer)\n";
+    std::cout << "text cache   " << g_textCacheHits << " hits, " << g_textCacheMisses << " misses\n";
+    clearTextCache();
+    if (g_smallFont) TTF_CloseFont(g_smallFont);
+    releaseTextures();
+    SDL_DestroyRenderer(g_renderer); g_renderer = nullptr; SDL_DestroySurface(target);
+    TTF_Quit(); unmapFile(g_bundle.file);
+    return 0;
 }
-void renderSceneFinish() { drawGameWorld(); SDL_Color tc={0,0,0,255}; SDL_Surface*s=nullptr; SDL_Texture*t=nullptr; SDL_FRect tr; s=TTF_RenderText_Blended(g_font,"CHUC MUNG!",0,tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,100,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} std::string st="Vat pham: "+std::to_string(g_totalItemCount);s=TTF_RenderText_Blended(g_font,st.c_str(),st.length(),tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,200,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} std::string tt="Thoi gian: "+std::to_string(g_playTimeSeconds)+"s";s=TTF_RenderText_Blended(g_smallFont,tt.c_str(),tt.length(),tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,300,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} s=TTF_RenderText_Blended(g_smallFont,"Bam ESC de ve Menu",0,tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,400,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} }
-void renderSceneGameOver() { drawGameWorld(); SDL_Color tc={255,255,255,255}; SDL_Surface*s=nullptr; SDL_Texture*t=nullptr; SDL_FRect tr; s=TTF_RenderText_Blended(g_font,"GAME OVER",0,tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,150,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} std::string st="Vat pham: "+std::to_string(g_totalItemCount);s=TTF_RenderText_Blended(g_smallFont,st.c_str(),st.length(),tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,300,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} s=TTF_RenderText_Blended(g_smallFont,"Bam ESC de ve Menu",0,tc);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={SCREEN_WIDTH/2.0f-s->w/2.0f,400,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} }
-void renderScenePause() { drawGameWorld(); SDL_SetRenderDrawColor(g_renderer, 0, 0, 0, 150); SDL_FRect overlayRect = {0, 0, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT}; SDL_RenderFillRect(g_renderer, &overlayRect); SDL_Color tc = {255, 255, 255, 255}; SDL_Surface* s = TTF_RenderText_Blended(g_font, "TAM DUNG", 0, tc); if (s) { SDL_Texture* t = SDL_CreateTextureFromSurface(g_renderer, s); SDL_FRect tr = {(SCREEN_WIDTH - s->w) / 2.0f, 150, (float)s->w, (float)s->h}; SDL_RenderTexture(g_renderer, t, nullptr, &tr); SDL_DestroySurface(s); SDL_DestroyTexture(t); } float mouseX, mouseY; SDL_GetMouseState(&mouseX, &mouseY); SDL_Color bc = {255, 105, 180, 200}, btn_tc = {80, 80, 80, 255}; bool hoverResume = checkCollision(mouseX, mouseY, g_pauseButtons[0].rect); renderRoundedButton(g_renderer, g_pauseButtons[0], g_font, g_buttonTexture, bc, btn_tc, hoverResume); bool hoverMenu = checkCollision(mouseX, mouseY, g_pauseButtons[1].rect); renderRoundedButton(g_renderer, g_pauseButtons[1], g_font, g_buttonTexture, bc, btn_tc, hoverMenu); }
-void renderSceneScore() { SDL_SetRenderDrawColor(g_renderer, 30, 30, 70, 255); SDL_RenderClear(g_renderer); SDL_Color tc1={255,215,0,255}, tc2={255,255,255,255}, tc3={180,180,180,255}; SDL_Surface*s=nullptr; SDL_Texture*t=nullptr; SDL_FRect tr; s=TTF_RenderText_Blended(g_font,"HIGH SCORES",0,tc1);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={(SCREEN_WIDTH-(float)s->w)/2.0f,50,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} float y=150.0f; int r=1; if(g_highScores.empty()){s=TTF_RenderText_Blended(g_smallFont,"No scores yet. Go play!",0,tc3);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={(SCREEN_WIDTH-(float)s->w)/2.0f,y,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);}}else{for(int sc:g_highScores){std::string sl=std::to_string(r)+".   "+std::to_string(sc);s=TTF_RenderText_Blended(g_smallFont,sl.c_str(),sl.length(),tc2);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={(SCREEN_WIDTH/2.0f)-100.0f,y,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);}y+=35.0f;r++;if(r>10)break;}}s=TTF_RenderText_Blended(g_smallFont,"Press ESC for Menu",0,tc3);if(s){t=SDL_CreateTextureFromSurface(g_renderer,s);tr={(SCREEN_WIDTH-(float)s->w)/2.0f,SCREEN_HEIGHT-60.0f,(float)s->w,(float)s->h};SDL_RenderTexture(g_renderer,t,nullptr,&tr);SDL_DestroySurface(s);SDL_DestroyTexture(t);} }
-void renderSceneMenu(Uint32 currentTime) { if(g_backgroundTexture&&g_bgWidth>0&&g_bgHeight>0){ float scrollSpeed=30.0f; float dt=0.0f; if (g_lastTime != 0 && currentTime > g_lastTime) { dt = (currentTime - g_lastTime) / 1000.0f; } if(dt>0.05f)dt=0.05f; g_menuBgOffsetX+=scrollSpeed*dt; float s=(float)SCREEN_HEIGHT/g_bgHeight,sw=g_bgWidth*s,o=fmod(g_menuBgOffsetX,sw);SDL_FRect r1={-o,0,sw,(float)SCREEN_HEIGHT},r2={-o+sw,0,sw,(float)SCREEN_HEIGHT};SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r1);SDL_RenderTexture(g_renderer,g_backgroundTexture,nullptr,&r2);} else {SDL_SetRenderDrawColor(g_renderer,173,216,230,255);SDL_RenderClear(g_renderer);} if(g_logoTexture){if(g_alpha<255&&!g_shrinking){g_alpha=(Uint8)SDL_min(g_alpha+3,255);SDL_SetTextureAlphaMod(g_logoTexture,g_alpha);}else{g_shrinking=true;}if(g_shrinking){if(g_logoRect.w>100){g_logoRect.w*=0.98f;g_logoRect.h*=0.98f;g_logoRect.x=(SCREEN_WIDTH-g_logoRect.w)/2.0f;g_logoRect.y=50.0f;}else{g_logoRect.x=20.0f;g_logoRect.y=20.0f;g_logoRect.w=100.0f;g_logoRect.h=100.0f;}}SDL_RenderTexture(g_renderer,g_logoTexture,nullptr,&g_logoRect);} if(g_player){float lw=100,lh=120;SDL_FRect lr={150.0f,SCREEN_HEIGHT-lh-50.0f,lw,lh};lr.y+=sinf((float)currentTime/500.0f)*5.0f;SDL_RenderTexture(g_renderer,g_player,nullptr,&lr);} g_buttons[0].rect={350,200,180,80}; g_buttons[1].rect={350,300,180,80}; g_buttons[2].rect={350,400,180,80}; if(currentTime-g_startTime>2000){ float mouseX, mouseY; SDL_GetMouseState(&mouseX, &mouseY); SDL_Color bc={255,105,180,200}, tc={80,80,80,255}; bool hoverPlay = checkCollision(mouseX, mouseY, g_buttons[0].rect); renderRoundedButton(g_renderer, g_buttons[0], g_font, g_buttonTexture, bc, tc, hoverPlay); bool hoverResume = checkCollision(mouseX, mouseY, g_buttons[1].rect); if (g_gameInProgress) { SDL_Color resume_bc = {100, 200, 255, 220}; SDL_Color resume_tc = {255, 255, 255, 255}; if (!hoverResume) { Uint8 alpha = 128 + (Uint8)((sinf((float)currentTime / 200.0f) + 1.0f) * 64); SDL_SetTextureAlphaMod(g_buttonTexture, alpha); } renderRoundedButton(g_renderer, g_buttons[1], g_font, g_buttonTexture, resume_bc, resume_tc, hoverResume); SDL_SetTextureAlphaMod(g_buttonTexture, 255); } else { renderRoundedButton(g_renderer, g_buttons[1], g_font, g_buttonTexture, bc, tc, hoverResume); } bool hoverScore = checkCollision(mouseX, mouseY, g_buttons[2].rect); renderRoundedButton(g_renderer, g_buttons[2], g_font, g_buttonTexture, bc, tc, hoverScore); } }
 
-// Reset Function
-void resetPlayer() {
-    player.rect.x = 100; player.rect.y = 300; player.velocityX = 0; player.velocityY = 0;
-    player.onGround = false; player.hp = 100; player.canDoubleJump = false;
-    player.coyoteTimer = 0.0f; player.jumpBufferTimer = 0.0f; player.jumpInputPressed = false;
-    g_cameraX = 0; g_score = 0; g_level = 1; g_maxMoveSpeed = MAX_MOVE_SPEED; g_damageItemSpeedMultiplier = 1.0f;
-    g_itemCount = 0; g_totalItemCount = 0; g_gameStartTime = SDL_GetTicks(); g_playTimeSeconds = 0;
-    g_gameInProgress = true; g_levelUpTextStartTime = 0; g_playerIsFlashing = false;
-    createObstacles(); createCollectibles(); createDamageItems(); createMysteryItems();
+// Gameplay Capture (F9): frames are read back just before present into a ring of staging surfaces, and an
+// encoder thread converts them to I420 and appends them to a Y4M stream. A full ring drops the frame rather than
+// blocking the game; the encoder repeats the previous frame over the gap so the video keeps real time
+const int CAPTURE_FPS = 60;
+const Uint32 CAPTURE_RING = 8;
+const Uint64 CAPTURE_MAX_GAP = CAPTURE_FPS; // idle scenes present nothing; longer gaps are cut to a second
+struct CaptureFrame { SDL_Surface* surface; Uint64 index; }; // index: 1/CAPTURE_FPS slots since the capture started
+struct Capture {
+    std::thread encoder; std::mutex mutex; std::condition_variable wake;
+    CaptureFrame ring[CAPTURE_RING]; std::atomic<Uint32> head{0}, tail{0}; // head: main thread, tail: encoder
+    bool active = false, stopping = false; // stopping guarded by mutex
+    std::string path; std::ofstream out;
+    Uint64 startNS = 0, nextIndex = 0, captured = 0, dropped = 0, written = 0; // written: encoder, read after join
+};
+Capture g_capture; std::string g_capturePath; int g_captureCount = 0;
+
+// Full-range BT.601, chroma averaged over each 2x2 block; src is ARGB8888 rows (B, G, R, A in memory)
+void convertToI420(const SDL_Surface* s, int w, int h, std::vector<Uint8>& yuv) {
+    Uint8* py = yuv.data(); Uint8* pu = py + (size_t)w * h; Uint8* pv = pu + (size_t)(w / 2) * (h / 2);
+    for (int y = 0; y < h; y += 2) {
+        const Uint8* r0 = (const Uint8*)s->pixels + (size_t)y * s->pitch; const Uint8* r1 = r0 + s->pitch;
+        for (int x = 0; x < w; x += 2) {
+            int sr = 0, sg = 0, sb = 0;
+            for (int k = 0; k < 4; k++) {
+                const Uint8* px = (k < 2 ? r0 : r1) + (x + (k & 1)) * 4;
+                const int b = px[0], g = px[1], r = px[2]; sr += r; sg += g; sb += b;
+                py[(size_t)(y + (k >> 1)) * w + x + (k & 1)] = (Uint8)((77 * r + 150 * g + 29 * b + 128) >> 8);
+            }
+            const size_t c = (size_t)(y / 2) * (w / 2) + x / 2;
+            pu[c] = (Uint8)std::min(255, ((-43 * sr - 85 * sg + 128 * sb + 512) >> 10) + 128);
+            pv[c] = (Uint8)std::min(255, ((128 * sr - 107 * sg - 21 * sb + 512) >> 10) + 128);
+        }
+    }
+}
+void captureEncoderMain() {
+    Capture& c = g_capture;
+    std::vector<Uint8> yuv; int w = 0, h = 0; Uint64 lastIndex = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(c.mutex);
+            c.wake.wait(lock, [&c]() { return c.stopping || c.head.load() != c.tail.load(); });
+            if (c.head.load() == c.tail.load()) return; // stopping and drained
+        }
+        const Uint32 tail = c.tail.load(std::memory_order_relaxed);
+        CaptureFrame f = c.ring[tail % CAPTURE_RING];
+        SDL_Surface* s = f.surface;
+        if (s->format != SDL_PIXELFORMAT_ARGB8888 && s->format != SDL_PIXELFORMAT_XRGB8888) { SDL_Surface* conv = SDL_ConvertSurface(s, SDL_PIXELFORMAT_ARGB8888); SDL_DestroySurface(s); s = conv; }
+        if (s && w == 0) {
+            w = s->w & ~1; h = s->h & ~1; yuv.resize((size_t)w * h * 3 / 2);
+            c.out << "YUV4MPEG2 W" << w << " H" << h << " F" << CAPTURE_FPS << ":1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+        }
+        if (s && s->w >= w && s->h >= h && w > 0) {
+            if (c.written > 0) for (Uint64 i = 1; i < std::min(f.index - lastIndex, CAPTURE_MAX_GAP); i++) { c.out << "FRAME\n"; c.out.write((const char*)yuv.data(), (std::streamsize)yuv.size()); c.written++; }
+            convertToI420(s, w, h, yuv);
+            c.out << "FRAME\n"; c.out.write((const char*)yuv.data(), (std::streamsize)yuv.size()); c.written++;
+            lastIndex = f.index;
+        }
+        if (s) SDL_DestroySurface(s);
+        c.tail.store(tail + 1, std::memory_order_release);
+    }
+}
+bool startCapture(const std::string& path) {
+    Capture& c = g_capture;
+    c.out.open(path, std::ios::binary);
+    if (!c.out) { std::cout << "Failed write " << path << "\n"; c.out.clear(); return false; }
+    c.path = path; c.startNS = SDL_GetTicksNS(); c.nextIndex = 0; c.captured = c.dropped = c.written = 0;
+    c.stopping = false; c.encoder = std::thread(captureEncoderMain); c.active = true;
+    std::cout << "Capture: recording " << CAPTURE_FPS << " fps Y4M to " << path << "\n";
+    return true;
+}
+void stopCapture() {
+    Capture& c = g_capture;
+    if (!c.active) return;
+    c.active = false;
+    { std::lock_guard<std::mutex> lock(c.mutex); c.stopping = true; }
+    c.wake.notify_one(); c.encoder.join(); c.out.close();
+    std::cout << "Capture: " << c.written << " frames written to " << c.path << " (" << c.captured << " captured, " << c.dropped << " dropped)\n";
+}
+// --capture FILE names the first recording; later ones (and all of them without it) are numbered
+void toggleCapture() {
+    if (g_capture.active) { stopCapture(); return; }
+    std::string path = g_captureCount++ == 0 ? g_capturePath : std::string();
+    for (int n = 1; path.empty(); n++) { std::string candidate = "capture-" + std::to_string(n) + ".y4m"; if (!std::ifstream(candidate).good()) path = candidate; }
+    startCapture(path);
+}
+// Called with the finished frame still in the back buffer, once per 1/CAPTURE_FPS slot
+void captureFrame() {
+    Capture& c = g_capture;
+    if (!c.active) return;
+    const Uint64 index = (SDL_GetTicksNS() - c.startNS) * CAPTURE_FPS / 1000000000ull;
+    if (index < c.nextIndex) return;
+    ProfScope ps(PROF_CAPTURE);
+    c.nextIndex = index + 1;
+    const Uint32 head = c.head.load(std::memory_order_relaxed);
+    if (head - c.tail.load(std::memory_order_acquire) >= CAPTURE_RING) { c.dropped++; return; } // encoder behind: drop, never wait
+    SDL_Surface* s = SDL_RenderReadPixels(g_renderer, nullptr);
+    if (!s) { c.dropped++; return; }
+    c.ring[head % CAPTURE_RING] = {s, index}; c.captured++;
+    { std::lock_guard<std::mutex> lock(c.mutex); c.head.store(head + 1, std::memory_order_release); }
+    c.wake.notify_one();
 }
 
+// Frame Pacing: frame times come from the nanosecond clock. A limiter stands in for vsync when it is off or
+// unavailable, and scenes where nothing moves block in SDL_WaitEventTimeout instead of presenting every refresh
+const int IDLE_ANIMATION_FPS = 30; // settled menu: only the scrolling background, bobbing player and resume pulse move
+Uint64 g_frameIntervalNS = 0, g_nextFrameNS = 0; // limiter period, 0 while vsync paces the loop
+int displayRefreshRate() {
+    const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(g_window));
+    return mode && mode->refresh_rate > 0.0f ? (int)(mode->refresh_rate + 0.5f) : 60;
+}
+// How long the loop may wait for input before drawing the next frame: 0 while animating, -1 until an event arrives
+Sint32 idleTimeoutMS(Scene drawnScene, Uint32 now) {
+    if (g_currentScene != drawnScene || g_profOverlay || g_replayActive) return 0;
+    switch (g_currentScene) {
+    case Scene::PLAY: return 0;
+    case Scene::MENU: return g_shrinking && g_logoRect.w <= 100.0f && now - g_startTime > 2000 ? 1000 / IDLE_ANIMATION_FPS : 0;
+    default: return -1;
+    }
+}
+// A fast replay renders one tick per frame with vsync off, so the workload is identical between builds
+void setFramePacing(bool fastReplay, int fps) {
+    const bool vsync = !fastReplay && SDL_SetRenderVSync(g_renderer, 1);
+    if (fastReplay) SDL_SetRenderVSync(g_renderer, 0);
+    const int fpsLimit = fps >= 0 ? fps : (vsync || fastReplay ? 0 : displayRefreshRate());
+    g_frameIntervalNS = fpsLimit > 0 ? 1000000000ull / (Uint64)fpsLimit : 0; g_nextFrameNS = SDL_GetTicksNS();
+    if (fpsLimit > 0 && g_profLogging) std::cout << "Frame limiter: " << fpsLimit << " fps" << (vsync ? "" : ", vsync off") << "\n";
+}
+// Once a fast replay has ended the player owns the run, so it goes back to real-time ticks on the sim thread
+void leaveFastReplay(int fps) { setFramePacing(false, fps); startSimThread(false); }
+// Sleeps to the next deadline. Deadlines advance by whole periods so pacing stays even, and a frame that
+// overran by more than a period restarts the schedule instead of rushing to catch up
+void paceFrame() {
+    if (g_frameIntervalNS == 0) return;
+    const Uint64 now = SDL_GetTicksNS();
+    if (now < g_nextFrameNS) { SDL_DelayPrecise(g_nextFrameNS - now); g_nextFrameNS += g_frameIntervalNS; }
+    else g_nextFrameNS = now - g_nextFrameNS < g_frameIntervalNS ? g_nextFrameNS + g_frameIntervalNS : now + g_frameIntervalNS;
+}
 
 // Main Function
 int main(int argc, char* argv[]) {
+    HeadlessOptions opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") opt.headless = true;
+        else if (arg == "--bench") opt.bench = true;
+        else if (arg == "--endless") opt.endless = true;
+        else if (arg == "--frames" && i + 1 < argc) opt.frames = std::max(1, atoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc) { opt.seed = (unsigned int)strtoul(argv[++i], nullptr, 10); opt.hasSeed = true; }
+        else if (arg == "--record" && i + 1 < argc) opt.recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) opt.replayPath = argv[++i];
+        else if (arg == "--fast") opt.fast = true;
+        else if (arg == "--capture" && i + 1 < argc) g_capturePath = argv[++i];
+        else if (arg == "--fps" && i + 1 < argc) opt.fps = std::max(0, atoi(argv[++i]));
+        else if (arg == "--profile" && i + 1 < argc) opt.profilePath = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc) opt.batch = std::max(1, atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) opt.threads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--items-per-level" && i + 1 < argc) opt.difficulty.itemsPerLevel = std::max(1, atoi(argv[++i]));
+        else if (arg == "--speed-ramp" && i + 1 < argc) opt.difficulty.speedRamp = (float)atof(argv[++i]);
+        else if (arg == "--damage-ramp" && i + 1 < argc) opt.difficulty.damageSpeedRamp = (float)atof(argv[++i]);
+        else { std::cout << "Usage: UET_RUN [--headless | --bench | --batch N [--threads T]] [--endless] [--frames N] [--seed S] [--record FILE | --replay FILE [--fast]] [--profile FILE.json|FILE.csv]\n"
+                          "               [--fps N] [--capture FILE.y4m] [--items-per-level N] [--speed-ramp F] [--damage-ramp F]\n"
+                          "  --record FILE  records every session: the first to FILE, later ones in the same run to FILE-2, FILE-3, ...\n"; return 1; }
+    }
+    g_difficulty = opt.difficulty;
+    g_endlessMode = opt.endless; g_recordPath = opt.recordPath; g_profPath = opt.profilePath; g_profLogging = !g_profPath.empty();
+    if (opt.bench) return runBenchmarks(opt);
+    if (opt.batch > 0) { g_profLogging = false; return runBatch(opt); } // the trace log is not shared across threads
+    if (opt.headless) { int rc = runHeadless(opt); exportProfile(); return rc; }
+    if (!opt.replayPath.empty() && !loadRecording(opt.replayPath, g_replay)) return 1;
+
     if (!SDL_Init(SDL_INIT_VIDEO)) { std::cout << "SDL_Init failed: " << SDL_GetError() << "\n"; return 1; }
     if (!TTF_Init()) { std::cout << "TTF_Init failed: " << SDL_GetError() << "\n"; SDL_Quit(); return 1; } // Sửa lỗi TTF -> SDL
 
-    srand((unsigned int)time(NULL));
+    seedSessions(opt.hasSeed ? opt.seed : (Uint64)time(NULL));
 
     g_window = SDL_CreateWindow("UET_RUN", SCREEN_WIDTH, SCREEN_HEIGHT, 0);
     g_renderer = SDL_CreateRenderer(g_window, nullptr);
     if (!g_renderer) { std::cout << "Failed create renderer: " << SDL_GetError() << "\n"; SDL_DestroyWindow(g_window); TTF_Quit(); SDL_Quit(); return 1; }
-    SDL_SetRenderVSync(g_renderer, 1);
+    const bool fastReplay = opt.fast && !opt.replayPath.empty();
+    setFramePacing(fastReplay, opt.fps);
 
-    // Load Textures (Thêm kiểm tra lỗi)
-    g_logoTexture = IMG_LoadTexture(g_renderer, "Assets/uet.png"); if (!g_logoTexture) std::cout << "Warning: Failed load Assets/uet.png: " << SDL_GetError() << "\n";
-    g_buttonTexture = IMG_LoadTexture(g_renderer, "Assets/button.png"); if (!g_buttonTexture) std::cout << "Warning: Failed load Assets/button.png: " << SDL_GetError() << "\n";
-    g_player = IMG_LoadTexture(g_renderer, "Assets/player.png"); if (!g_player) std::cout << "Warning: Failed load Assets/player.png: " << SDL_GetError() << "\n";
-    g_damageItemTexture = IMG_LoadTexture(g_renderer, "Assets/bad.png"); if (!g_damageItemTexture) std::cout << "Warning: Failed load Assets/bad.png: " << SDL_GetError() << "\n";
-    g_collectibleTexture = IMG_LoadTexture(g_renderer, "Assets/item.png"); if (!g_collectibleTexture) std::cout << "Warning: Failed load Assets/item.png: " << SDL_GetError() << "\n";
-    g_mysteryItemTexture = IMG_LoadTexture(g_renderer, "Assets/mystery.png"); if (!g_mysteryItemTexture) std::cout << "Warning: Failed load Assets/mystery.png: " << SDL_GetError() << "\n";
-    g_obstacleTexture = IMG_LoadTexture(g_renderer, "Assets/deadline.png"); if (!g_obstacleTexture) std::cout << "Warning: Failed load Assets/deadline.png: " << SDL_GetError() << "\n";
-    g_backgroundTexture = IMG_LoadTexture(g_renderer, "Assets/background.png"); if (g_backgroundTexture) SDL_GetTextureSize(g_backgroundTexture, &g_bgWidth, &g_bgHeight); else std::cout << "Warning: Failed load Assets/background.png: " << SDL_GetError() << "\n";
-    g_heartFullTexture = IMG_LoadTexture(g_renderer, "Assets/heart_full.png"); if (!g_heartFullTexture) std::cout << "Warning: Failed load Assets/heart_full.png: " << SDL_GetError() << "\n";
-    g_heartEmptyTexture = IMG_LoadTexture(g_renderer, "Assets/heart_empty.png"); if (!g_heartEmptyTexture) std::cout << "Warning: Failed load Assets/heart_empty.png: " << SDL_GetError() << "\n";
+    // Load Textures: decoding starts on worker threads right away and is uploaded behind the loading screen
+    const Uint64 loadStart = SDL_GetTicks();
+    const bool bundled = openAssetBundle() && loadBundleTextures();
+    AssetLoader loader; if (!bundled) startAssetLoader(loader);
+    const size_t loaderThreads = loader.workers.size();
 
 
     // Load Fonts (Chỉ thử tải từ thư mục hiện tại)
-    const char* fontPath = "Fredoka_SemiCondensed-Medium.ttf";
-    g_font = TTF_OpenFont(fontPath, 36);
-    g_smallFont = TTF_OpenFont(fontPath, 24);
+    g_font = openGameFont(36);
+    g_smallFont = openGameFont(24);
     if (!g_font || !g_smallFont) {
-        std::cout << "Failed to load font " << fontPath << ": " << SDL_GetError() << "\n";
+        std::cout << "Failed to load font " << FONT_PATH << ": " << SDL_GetError() << "\n";
+        while (!pumpAssetLoader(loader)) SDL_Delay(1);
         if(g_renderer)SDL_DestroyRenderer(g_renderer);
         if(g_window)SDL_DestroyWindow(g_window);
         TTF_Quit();
@@ -419,80 +1984,103 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    initParticles();
 
-    // Load Level Up Text Texture
-    SDL_Color levelUpColor = {255, 215, 0, 255};
-    SDL_Surface* surface = TTF_RenderText_Blended(g_font, "LEVEL UP!", 0, levelUpColor);
-    if (surface) {
-        g_levelUpTextTexture = SDL_CreateTextureFromSurface(g_renderer, surface);
-        SDL_DestroySurface(surface);
-        if (!g_levelUpTextTexture) { std::cout << "Warning: Failed create Level Up texture: " << SDL_GetError() << "\n"; }
-    } else { std::cout << "Warning: Failed create Level Up surface: " << SDL_GetError() << "\n"; } // Sửa lỗi TTF -> SDL
-
-
-    g_startTime = SDL_GetTicks();
-    g_lastTime = SDL_GetTicks();
 
     bool running = true;
     SDL_Event e;
+    while (!pumpAssetLoader(loader)) {
+        while (SDL_PollEvent(&e)) if (e.type == SDL_EVENT_QUIT) running = false;
+        renderLoadingFrame(loader); SDL_RenderPresent(g_renderer);
+    }
+    if (g_profLogging) { // timings are for profiling runs; a normal start only reports problems
+        if (bundled) std::cout << "Assets loaded in " << SDL_GetTicks() - loadStart << " ms from " << BUNDLE_PATH << "\n";
+        else std::cout << "Assets loaded in " << SDL_GetTicks() - loadStart << " ms on " << loaderThreads << " threads\n";
+    }
+
+    g_startTime = SDL_GetTicks();
+    g_lastTime = SDL_GetTicksNS(); g_nextFrameNS = g_lastTime;
+    startSimThread(fastReplay);
+    if (!g_capturePath.empty()) toggleCapture();
+    if (!opt.replayPath.empty()) { startReplay(); g_currentScene = Scene::PLAY; resetPlayer(true); }
 
+    Scene drawnScene = g_currentScene;
     while (running) {
-        Uint64 frameStartTime = SDL_GetTicks();
+        const Sint32 idleMS = idleTimeoutMS(drawnScene, (Uint32)SDL_GetTicks());
+        if (idleMS != 0) SDL_WaitEventTimeout(nullptr, idleMS); // leaves the event queued for the loop below
+        profBeginFrame();
+        const Uint64 frameStartNS = SDL_GetTicksNS();
         float dt = 0.0f;
         if (g_currentScene == Scene::PLAY || g_currentScene == Scene::MENU) {
-            dt = (frameStartTime - g_lastTime) / 1000.0f;
-            g_lastTime = frameStartTime;
+            dt = (float)((double)(frameStartNS - g_lastTime) * 1e-9);
+            g_lastTime = frameStartNS;
+            if (g_sim.lockstep) dt = SIM_DT;
         }
-        Uint32 menuCurrentTime = frameStartTime;
+        Uint32 menuCurrentTime = (Uint32)(frameStartNS / 1000000u);
 
+        Uint64 eventStart = profStart();
         while (SDL_PollEvent(&e)) {
              if (e.type == SDL_EVENT_QUIT) running = false;
              else if (e.type == SDL_EVENT_KEY_DOWN) {
-                 if (e.key.key == SDLK_ESCAPE) { if (g_currentScene == Scene::PLAY) { g_currentScene = Scene::PAUSE; } else if (g_currentScene != Scene::MENU) { g_currentScene = Scene::MENU; g_alpha=0; g_shrinking=false; g_logoRect={200,100,400,400}; g_lastTime = SDL_GetTicks(); } else { running = false; } }
-                 else if (e.key.key == SDLK_P) { if (g_currentScene == Scene::PLAY) { g_currentScene = Scene::PAUSE; } else if (g_currentScene == Scene::PAUSE) { g_currentScene = Scene::PLAY; g_lastTime = SDL_GetTicks(); } }
-                 else if (g_currentScene == Scene::PLAY && (e.key.key == SDLK_W || e.key.key == SDLK_SPACE)) { if (!e.key.repeat) { player.jumpInputPressed = true; } }
+                 if (e.key.key == SDLK_ESCAPE) { if (g_currentScene == Scene::PLAY) { g_currentScene = Scene::PAUSE; } else if (g_currentScene != Scene::MENU) { g_currentScene = Scene::MENU; g_alpha=0; g_shrinking=false; g_logoRect={200,100,400,400}; g_lastTime = SDL_GetTicksNS(); } else { running = false; } }
+                 else if (e.key.key == SDLK_F3) { g_profOverlay = !g_profOverlay; }
+                 else if (e.key.key == SDLK_F9) { toggleCapture(); }
+                 else if (e.key.key == SDLK_P) { if (g_currentScene == Scene::PLAY) { g_currentScene = Scene::PAUSE; } else if (g_currentScene == Scene::PAUSE) { g_currentScene = Scene::PLAY; g_lastTime = SDL_GetTicksNS(); } }
+             }
+             // Movement keys are forwarded to the sim thread with their timestamps; held state is tracked here
+             if ((e.type == SDL_EVENT_KEY_DOWN || e.type == SDL_EVENT_KEY_UP) && !e.key.repeat) {
+                 const bool down = e.type == SDL_EVENT_KEY_DOWN;
+                 Uint8 bit = e.key.scancode == SDL_SCANCODE_A ? INPUT_LEFT : e.key.scancode == SDL_SCANCODE_D ? INPUT_RIGHT : (e.key.scancode == SDL_SCANCODE_W || e.key.scancode == SDL_SCANCODE_SPACE) ? INPUT_JUMP_HELD : 0;
+                 if (bit) { g_inputHeld = down ? (Uint8)(g_inputHeld | bit) : (Uint8)(g_inputHeld & ~bit); if (g_currentScene == Scene::PLAY) pushInput(e.key.timestamp, down && bit == INPUT_JUMP_HELD); }
              }
+             else if (e.type == SDL_EVENT_RENDER_TARGETS_RESET || e.type == SDL_EVENT_RENDER_DEVICE_RESET) invalidateFrozenFrame();
+             else if (e.type == SDL_EVENT_WINDOW_FOCUS_LOST) { g_inputHeld = 0; pushInput(e.common.timestamp, false); }
              else if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN && e.button.button == SDL_BUTTON_LEFT) {
                  float mx=(float)e.button.x, my=(float)e.button.y;
-                 if (g_currentScene == Scene::MENU && menuCurrentTime - g_startTime > 2000) { if (checkCollision(mx,my,g_buttons[0].rect)) { g_currentScene = Scene::PLAY; resetPlayer(); g_lastTime = SDL_GetTicks(); } else if (checkCollision(mx,my,g_buttons[1].rect)) { if (g_gameInProgress) { g_currentScene = Scene::PLAY; g_lastTime = SDL_GetTicks(); } else { g_currentScene = Scene::PLAY; resetPlayer(); g_lastTime = SDL_GetTicks(); } } else if (checkCollision(mx,my,g_buttons[2].rect)) { g_currentScene = Scene::SCORE; } }
-                 else if (g_currentScene == Scene::PAUSE) { if (checkCollision(mx, my, g_pauseButtons[0].rect)) { g_currentScene = Scene::PLAY; g_lastTime = SDL_GetTicks(); } else if (checkCollision(mx, my, g_pauseButtons[1].rect)) { g_currentScene = Scene::MENU; g_alpha=0; g_shrinking=false; g_logoRect={200,100,400,400}; g_lastTime = SDL_GetTicks(); } }
+                 if (g_currentScene == Scene::MENU && menuCurrentTime - g_startTime > 2000) { if (checkCollision(mx,my,g_buttons[0].rect)) { g_currentScene = Scene::PLAY; g_endlessMode = false; resetPlayer(); g_lastTime = SDL_GetTicksNS(); } else if (checkCollision(mx,my,g_buttons[1].rect)) { if (g_gameInProgress) { g_currentScene = Scene::PLAY; g_lastTime = SDL_GetTicksNS(); } else { g_currentScene = Scene::PLAY; resetPlayer(); g_lastTime = SDL_GetTicksNS(); } } else if (checkCollision(mx,my,g_buttons[2].rect)) { g_currentScene = Scene::SCORE; } else if (checkCollision(mx,my,g_buttons[3].rect)) { g_currentScene = Scene::PLAY; g_endlessMode = true; resetPlayer(); g_lastTime = SDL_GetTicksNS(); } }
+                 else if (g_currentScene == Scene::PAUSE) { if (checkCollision(mx, my, g_pauseButtons[0].rect)) { g_currentScene = Scene::PLAY; g_lastTime = SDL_GetTicksNS(); } else if (checkCollision(mx, my, g_pauseButtons[1].rect)) { g_currentScene = Scene::MENU; g_alpha=0; g_shrinking=false; g_logoRect={200,100,400,400}; g_lastTime = SDL_GetTicksNS(); } }
             }
         }
 
-        const bool* keystate = SDL_GetKeyboardState(nullptr);
-        bool isMovingLeft = keystate[SDL_SCANCODE_A];
-        bool isMovingRight = keystate[SDL_SCANCODE_D];
-        bool isJumpHeld = keystate[SDL_SCANCODE_W] || keystate[SDL_SCANCODE_SPACE];
+        if (g_sim.lockstep && !g_replayActive) leaveFastReplay(opt.fps);
+        if (g_currentScene == Scene::PLAY) simResume(); else simPause();
+        simApplyStop();
+        profRecord(PROF_EVENTS, eventStart);
 
+        drawnScene = g_currentScene;
         switch (g_currentScene) {
-            case Scene::MENU: renderSceneMenu(menuCurrentTime); break;
-            case Scene::PLAY: renderScenePlay(dt, isMovingLeft, isMovingRight, isJumpHeld); break;
+            case Scene::MENU: renderSceneMenu(menuCurrentTime, dt); break;
+            case Scene::PLAY: renderScenePlay(dt); break;
             case Scene::PAUSE: renderScenePause(); break;
             case Scene::SCORE: renderSceneScore(); break;
             case Scene::FINISH: renderSceneFinish(); break;
             case Scene::GAME_OVER: renderSceneGameOver(); break;
         }
-        SDL_RenderPresent(g_renderer);
+        // Only where the next run can start from; a pause resumes the current run
+        if ((g_currentScene == Scene::MENU || g_currentScene == Scene::FINISH || g_currentScene == Scene::GAME_OVER) && !g_replayActive) prepareNextTrack();
+        if (g_profOverlay) drawProfilerOverlay();
+        captureFrame();
+        if (g_capture.active) { SDL_FRect rec = {SCREEN_WIDTH - 22.0f, 8.0f, 14.0f, 14.0f}; SDL_SetRenderDrawColor(g_renderer, 230, 30, 30, 255); SDL_RenderFillRect(g_renderer, &rec); } // not in the video
+        { ProfScope ps(PROF_PRESENT); paceFrame(); SDL_RenderPresent(g_renderer); }
+        g_frameCounter++; trimTextCache();
+        profCollectSimThread(); profEndFrame();
     }
 
     // Cleanup
+    stopCapture(); stopSimThread(); stopTrackPreparation(); finishRecording(); exportProfile();
+    if (g_profLogging) std::cout << "Text cache: " << g_textCacheHits << " hits, " << g_textCacheMisses << " misses, " << g_digitAtlasDraws << " digit-atlas draws\n";
+    clearTextCache();
     if (g_font) TTF_CloseFont(g_font);
     if (g_smallFont) TTF_CloseFont(g_smallFont);
     if (g_logoTexture) SDL_DestroyTexture(g_logoTexture);
     if (g_buttonTexture) SDL_DestroyTexture(g_buttonTexture);
-    if (g_player) SDL_DestroyTexture(g_player);
+    if (g_atlasTexture) SDL_DestroyTexture(g_atlasTexture);
+    if (g_frozenFrame) SDL_DestroyTexture(g_frozenFrame);
     if (g_backgroundTexture) SDL_DestroyTexture(g_backgroundTexture);
-    if (g_damageItemTexture) SDL_DestroyTexture(g_damageItemTexture);
-    if (g_collectibleTexture) SDL_DestroyTexture(g_collectibleTexture);
-    if (g_mysteryItemTexture) SDL_DestroyTexture(g_mysteryItemTexture);
-    if (g_obstacleTexture) SDL_DestroyTexture(g_obstacleTexture);
-    if (g_levelUpTextTexture) SDL_DestroyTexture(g_levelUpTextTexture);
-    if (g_heartFullTexture) SDL_DestroyTexture(g_heartFullTexture);
-    if (g_heartEmptyTexture) SDL_DestroyTexture(g_heartEmptyTexture);
     if (g_renderer) SDL_DestroyRenderer(g_renderer);
     if (g_window) SDL_DestroyWindow(g_window);
 
-    TTF_Quit();
+    TTF_Quit(); unmapFile(g_bundle.file);
     SDL_Quit();
 
     return 0;
@@ -0,0 +1,99 @@
+// Asset Packer: decodes Assets/ and the UI font into one bundle of pre-decoded pixels (see asset_bundle.h).
+// Run from the source root: pack_assets [output], default assets.uetb
+#include "../asset_bundle.h"
+#include <SDL3_image/SDL_image.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+struct PackedEntry { BundleEntry entry; std::vector<Uint8> bytes; };
+
+PackedEntry makeEntry(const char* name, BundleEntryType type) {
+    PackedEntry p; memset(&p.entry, 0, sizeof(p.entry));
+    SDL_strlcpy(p.entry.name, name, sizeof(p.entry.name)); p.entry.type = type;
+    bundleSourceStamp(name, p.entry.sourceSize, p.entry.sourceTime); // the atlas has no file and keeps zeros
+    return p;
+}
+// Converts to the bundle pixel format and stores tightly packed rows
+bool addImage(std::vector<PackedEntry>& out, const char* name, SDL_Surface* src) {
+    SDL_Surface* s = SDL_ConvertSurface(src, BUNDLE_PIXEL_FORMAT);
+    if (!s) { std::cout << "Failed convert " << name << ": " << SDL_GetError() << "\n"; return false; }
+    PackedEntry p = makeEntry(name, BUNDLE_IMAGE);
+    p.entry.format = BUNDLE_PIXEL_FORMAT; p.entry.width = (Uint32)s->w; p.entry.height = (Uint32)s->h; p.entry.pitch = (Uint32)s->w * 4u;
+    p.bytes.resize((size_t)p.entry.pitch * s->h);
+    for (int y = 0; y < s->h; y++) memcpy(&p.bytes[(size_t)y * p.entry.pitch], (const Uint8*)s->pixels + (size_t)y * s->pitch, p.entry.pitch);
+    SDL_DestroySurface(s);
+    out.push_back(std::move(p));
+    return true;
+}
+// Same scaling as the game's loose-file path: decode, scale into the cell size, copy into the cell
+bool addAtlas(std::vector<PackedEntry>& out) {
+    SDL_Surface* atlas = SDL_CreateSurface(ATLAS_COLUMNS * ATLAS_CELL_SIZE, ATLAS_ROWS * ATLAS_CELL_SIZE, SDL_PIXELFORMAT_RGBA32);
+    if (!atlas) { std::cout << "Failed create atlas: " << SDL_GetError() << "\n"; return false; }
+    SDL_FillSurfaceRect(atlas, nullptr, 0);
+    bool ok = true;
+    for (int i = 0; i < SPRITE_COUNT && ok; i++) {
+        SDL_Surface* img = IMG_Load(SPRITE_PATHS[i]);
+        if (!img) { std::cout << "Failed load " << SPRITE_PATHS[i] << ": " << SDL_GetError() << "\n"; ok = false; break; }
+        SDL_Rect cell = spriteCell(i);
+        SDL_Surface* scaled = SDL_CreateSurface(cell.w, cell.h, SDL_PIXELFORMAT_RGBA32);
+        SDL_SetSurfaceBlendMode(img, SDL_BLENDMODE_NONE);
+        ok = scaled && SDL_BlitSurfaceScaled(img, nullptr, scaled, nullptr, SDL_SCALEMODE_LINEAR);
+        if (ok) { SDL_SetSurfaceBlendMode(scaled, SDL_BLENDMODE_NONE); ok = SDL_BlitSurface(scaled, nullptr, atlas, &cell); }
+        if (!ok) std::cout << "Failed pack " << SPRITE_PATHS[i] << ": " << SDL_GetError() << "\n";
+        if (scaled) SDL_DestroySurface(scaled);
+        SDL_DestroySurface(img);
+        PackedEntry p = makeEntry(SPRITE_PATHS[i], BUNDLE_SPRITE);
+        p.entry.x = (Uint32)cell.x; p.entry.y = (Uint32)cell.y; p.entry.width = (Uint32)cell.w; p.entry.height = (Uint32)cell.h;
+        out.push_back(std::move(p));
+    }
+    ok = ok && addImage(out, BUNDLE_ATLAS_NAME, atlas);
+    SDL_DestroySurface(atlas);
+    return ok;
+}
+bool addFile(std::vector<PackedEntry>& out, const char* path, BundleEntryType type) {
+    size_t size = 0; void* data = SDL_LoadFile(path, &size);
+    if (!data) { std::cout << "Failed read " << path << ": " << SDL_GetError() << "\n"; return false; }
+    PackedEntry p = makeEntry(path, type);
+    p.bytes.assign((const Uint8*)data, (const Uint8*)data + size);
+    SDL_free(data);
+    out.push_back(std::move(p));
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string outPath = argc > 1 ? argv[1] : BUNDLE_PATH;
+    std::vector<PackedEntry> entries;
+    bool ok = true;
+    for (int i = 0; i < IMAGE_COUNT && ok; i++) {
+        SDL_Surface* img = IMG_Load(IMAGE_PATHS[i]);
+        if (!img) { std::cout << "Failed load " << IMAGE_PATHS[i] << ": " << SDL_GetError() << "\n"; ok = false; break; }
+        ok = addImage(entries, IMAGE_PATHS[i], img);
+        SDL_DestroySurface(img);
+    }
+    ok = ok && addAtlas(entries) && addFile(entries, FONT_PATH, BUNDLE_FONT);
+    if (!ok) return 1;
+
+    // Payloads follow the entry table, each aligned so textures can be created straight from the mapping
+    Uint64 offset = sizeof(BundleHeader) + sizeof(BundleEntry) * entries.size();
+    for (PackedEntry& p : entries) {
+        if (p.bytes.empty()) continue;
+        offset = (offset + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+        p.entry.offset = offset; p.entry.size = p.bytes.size(); offset += p.bytes.size();
+    }
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) { std::cout << "Failed write " << outPath << "\n"; return 1; }
+    BundleHeader header = {}; memcpy(header.magic, BUNDLE_MAGIC, 4); header.version = BUNDLE_VERSION; header.entryCount = (Uint32)entries.size();
+    out.write((const char*)&header, sizeof(header));
+    for (const PackedEntry& p : entries) out.write((const char*)&p.entry, sizeof(p.entry));
+    for (const PackedEntry& p : entries) {
+        if (p.bytes.empty()) continue;
+        while ((Uint64)out.tellp() < p.entry.offset) out.put(0);
+        out.write((const char*)p.bytes.data(), (std::streamsize)p.bytes.size());
+    }
+    if (!out) { std::cout << "Failed write " << outPath << "\n"; return 1; }
+    std::cout << "Packed " << entries.size() << " entries (" << offset / 1024 << " KiB) into " << outPath << "\n";
+    return 0;
+}